@@ -37,10 +37,12 @@
 #include <dbus/dbus-glib.h>
 
 #include <connman-agent.h>
+#include <connman-client.h>
 
 #include "agent.h"
 
 struct input_data {
+	gchar *service;
 	gboolean numeric;
 	gpointer request_data;
 	GtkWidget *dialog;
@@ -48,6 +50,8 @@ struct input_data {
 };
 
 static struct input_data *input_data_inst = NULL;
+static ConnmanClient *agent_client = NULL;
+static ConnmanAgent *agent = NULL;
 
 static void input_free(struct input_data *input)
 {
@@ -55,6 +59,9 @@ static void input_free(struct input_data *input)
 
 	g_hash_table_destroy(input->entries);
 
+	connman_client_set_input_pending(agent_client, input->service, FALSE);
+	g_free(input->service);
+
 	if( input_data_inst == input )
 		input_data_inst = NULL;
 
@@ -100,8 +107,8 @@ static void show_dialog(gpointer data, gpointer user_data)
 	gtk_window_present(GTK_WINDOW(input->dialog));
 }
 
-static void request_input_dialog(GHashTable *request,
-						gpointer request_data)
+static void request_input_dialog(const char *service_id,
+				GHashTable *request, gpointer request_data)
 {
 	GtkWidget *dialog;
 	GtkWidget *label;
@@ -116,6 +123,7 @@ static void request_input_dialog(GHashTable *request,
 	if (!input)
 		return;
 
+	input->service = g_strdup(service_id);
 	input->request_data = request_data;
 
 	input->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
@@ -176,7 +184,9 @@ static void request_input_dialog(GHashTable *request,
 static void request_input(const char *service_id,
                               GHashTable *request, gpointer request_data, gpointer user_data)
 {
-	request_input_dialog(request, request_data);
+	connman_client_set_input_pending(agent_client, service_id, TRUE);
+
+	request_input_dialog(service_id, request, request_data);
 }
 
 static gboolean cancel_request(DBusGMethodInvocation *context,
@@ -191,10 +201,23 @@ static gboolean cancel_request(DBusGMethodInvocation *context,
 	return TRUE;
 }
 
-int setup_agents(void)
+/*
+ * The agent registers itself again whenever connmand restarts, so it
+ * is only set up once.
+ */
+int setup_agents(ConnmanClient *client)
 {
-	ConnmanAgent *agent = connman_agent_new();
-	connman_agent_setup(agent, "/org/gnome/connman/applet");
+	if (agent != NULL)
+		return 0;
+
+	agent = connman_agent_new();
+
+	agent_client = client;
+	if (connman_agent_setup(agent, "/org/gnome/connman/applet") == FALSE) {
+		g_object_unref(agent);
+		agent = NULL;
+		return -1;
+	}
 
 	connman_agent_set_request_input_func(agent, request_input, agent);
 	connman_agent_set_cancel_func(agent, cancel_request, agent);
@@ -206,4 +229,19 @@ int setup_agents(void)
 
 void cleanup_agents(void)
 {
+	if (agent == NULL)
+		return;
+
+	if (input_data_inst) {
+		connman_agent_request_input_abort(input_data_inst->request_data);
+
+		input_free(input_data_inst);
+	}
+
+	connman_agent_unregister(agent);
+
+	g_object_unref(agent);
+	agent = NULL;
+
+	agent_client = NULL;
 }
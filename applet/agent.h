@@ -25,5 +25,5 @@
  *
  */
 
-int setup_agents(void);
+int setup_agents(ConnmanClient *client);
 void cleanup_agents(void);
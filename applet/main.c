@@ -27,13 +27,38 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
+#include "connman-client.h"
+#include "connman-profile.h"
+#include "connman-recorder.h"
 #include "marshal.h"
-#include "marshal.c"
 
 #include "properties.h"
+#include "preferences.h"
 #include "status.h"
+#include "menu.h"
 #include "agent.h"
 
+static ConnmanClient *client = NULL;
+
+static gboolean option_profile = FALSE;
+
+static GOptionEntry options[] = {
+	{ "profile-startup", 0, 0, G_OPTION_ARG_NONE, &option_profile,
+				"Print a timeline of the startup", NULL },
+	{ NULL },
+};
+
+static const char *milestones[] = {
+	CONNMAN_PROFILE_GTK_INIT,
+	CONNMAN_PROFILE_BUS,
+	CONNMAN_PROFILE_ICONS,
+	CONNMAN_PROFILE_AGENT,
+	CONNMAN_PROFILE_PROPERTIES,
+	CONNMAN_PROFILE_PAINTED,
+	CONNMAN_PROFILE_POPULATED,
+	NULL
+};
+
 static gboolean global_ready = FALSE;
 static gint global_strength = -1;
 
@@ -91,6 +116,57 @@ static void update_service(DBusGProxy *proxy, const char *path)
 	properties_create(service, service_property_changed, NULL);
 }
 
+static gchar *tooltip_callback(void)
+{
+	struct connman_service_info info;
+	GString *text;
+	gchar *str;
+
+	if (service == NULL)
+		return NULL;
+
+	if (connman_client_get_service_info(client,
+			dbus_g_proxy_get_path(service), &info) == FALSE)
+		return NULL;
+
+	text = g_string_new(NULL);
+
+	str = g_markup_printf_escaped("<b>%s</b>",
+				info.name ? info.name : _("Unknown"));
+	g_string_append(text, str);
+	g_free(str);
+
+	if (info.address != NULL && *info.address != '\0') {
+		str = g_markup_printf_escaped(_("Address: %s"), info.address);
+		g_string_append_printf(text, "\n%s", str);
+		g_free(str);
+	}
+
+	if (info.type != CONNMAN_TYPE_ETHERNET)
+		g_string_append_printf(text, "\n%s %u%%",
+					_("Signal strength:"), info.strength);
+
+	if (info.connected > 0) {
+		GTimeVal now;
+		gint64 secs;
+
+		g_get_current_time(&now);
+
+		secs = now.tv_sec - info.connected / G_USEC_PER_SEC;
+		if (secs < 0)
+			secs = 0;
+
+		g_string_append_printf(text, "\n%s %u:%02u:%02u",
+				_("Connected for"), (guint) (secs / 3600),
+				(guint) (secs / 60 % 60), (guint) (secs % 60));
+	}
+
+	g_free(info.name);
+	g_free(info.address);
+
+	return g_string_free(text, FALSE);
+}
+
 static void iterate_list(const GValue *value, gpointer user_data)
 {
 	gchar **path = user_data;
@@ -133,11 +209,12 @@ static void manager_init(DBusGConnection *connection)
 					"/", "net.connman.Manager");
 
 	properties_create(manager, manager_property_changed, NULL);
-	setup_agents();
+	setup_agents(client);
 }
 
 static void manager_cleanup(void)
 {
+	cleanup_agents();
 	properties_destroy(manager);
 }
 
@@ -150,7 +227,6 @@ static void name_owner_changed(DBusGProxy *proxy, const char *name,
 	if (*new != '\0') {
 		status_offline();
 		properties_enable(manager);
-		setup_agents();
 	} else {
 		properties_disable(manager);
 		status_unavailable();
@@ -217,20 +293,16 @@ static void about_callback(GtkWidget *item, gpointer user_data)
 
 static void settings_callback(GtkWidget *item, gpointer user_data)
 {
-	const char *command = "connman-properties";
-
-	if (g_spawn_command_line_async(command, NULL) == FALSE)
-		g_printerr("Couldn't execute command: %s\n", command);
+	preferences_show(client);
 }
 
-static gboolean menu_callback(GtkMenu *menu)
+static GtkWidget *create_menu(void)
 {
+	GtkWidget *menu;
 	GtkWidget *item;
 
-	item = gtk_separator_menu_item_new();
-	gtk_widget_show(item);
+	menu = menu_init(client);
 
-	gtk_menu_shell_append(GTK_MENU_SHELL(menu), item);
 	item = gtk_image_menu_item_new_from_stock(GTK_STOCK_PREFERENCES, NULL);
 	g_signal_connect(item, "activate", G_CALLBACK(settings_callback), NULL);
 	gtk_widget_show(item);
@@ -241,21 +313,35 @@ static gboolean menu_callback(GtkMenu *menu)
 	gtk_widget_show(item);
 	gtk_menu_shell_append(GTK_MENU_SHELL(menu), item);
 
-	return TRUE;
+	return menu;
 }
 
-
 int main(int argc, char *argv[])
 {
 	DBusGConnection *connection;
 	DBusGProxy *proxy;
 	GError *error = NULL;
 
+	connman_profile_start();
+
 	bindtextdomain(GETTEXT_PACKAGE, LOCALEDIR);
 	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
 	textdomain(GETTEXT_PACKAGE);
 
-	gtk_init(&argc, &argv);
+	if (gtk_init_with_args(&argc, &argv, NULL, options,
+					GETTEXT_PACKAGE, &error) == FALSE) {
+		if (error != NULL) {
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+		return 1;
+	}
+
+	connman_profile_mark(CONNMAN_PROFILE_GTK_INIT);
+	connman_profile_setup(option_profile, milestones);
+
+	connman_recorder_setup();
+
 	gtk_window_set_default_icon_name("network-wireless");
 
 	g_set_application_name(_("Connection Manager"));
@@ -271,7 +357,18 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	status_init(menu_callback, NULL);
+	connman_profile_mark(CONNMAN_PROFILE_BUS);
+
+	/*
+	 * Get every initial query on the wire before decoding any icons,
+	 * so the daemon answers while the status icon is being set up.
+	 * The icon itself stays hidden until the first reply says what to
+	 * show.
+	 *
+	 * The preferences window runs in-process on this client, so it is
+	 * already populated by the time it gets opened.
+	 */
+	client = connman_client_new();
 
 	proxy = dbus_g_proxy_new_for_name(connection, DBUS_SERVICE_DBUS,
 					DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
@@ -284,10 +381,17 @@ int main(int argc, char *argv[])
 
 	manager_init(connection);
 
+	status_init(create_menu(), NULL);
+	status_set_tooltip_callback(tooltip_callback);
+
 	gtk_main();
 
 	manager_cleanup();
 
+	menu_cleanup();
+
+	g_object_unref(client);
+
 	dbus_g_proxy_disconnect_signal(proxy, "NameOwnerChanged",
 					G_CALLBACK(name_owner_changed), NULL);
 
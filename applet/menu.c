@@ -0,0 +1,361 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus/dbus-glib.h>
+#include <gtk/gtk.h>
+
+#include "connman-client.h"
+#include "connman-dbus.h"
+
+#include "menu.h"
+
+/* Service columns the menu items show */
+#define MENU_CHANGED	(CONNMAN_CHANGED(CONNMAN_COLUMN_NAME) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_TYPE) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_STATE) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_SECURITY) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH))
+
+struct menu_service {
+	gchar *path;
+	GtkWidget *item;
+	GtkWidget *name;
+	GtkWidget *security;
+	GtkWidget *strength;
+};
+
+static ConnmanClient *client = NULL;
+static GtkTreeModel *model = NULL;
+static GtkWidget *menu = NULL;
+static GtkWidget *separator = NULL;
+static GHashTable *services = NULL;
+static guint sort_id = 0;
+
+static gboolean is_connected(const gchar *state)
+{
+	return g_strcmp0(state, "ready") == 0 ||
+				g_strcmp0(state, "online") == 0;
+}
+
+/* Used for both Connect and Disconnect, which reply alike */
+static void call_reply(DBusGProxy *proxy, GError *error,
+							gpointer user_data)
+{
+	if (error != NULL) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+	}
+}
+
+static void item_activate(GtkMenuItem *item, gpointer user_data);
+
+static void service_update(struct menu_service *service)
+{
+	struct connman_service_info info;
+	gchar *str;
+
+	if (connman_client_get_service_info(client, service->path,
+							&info) == FALSE)
+		return;
+
+	gtk_label_set_text(GTK_LABEL(service->name),
+					info.name ? info.name : "");
+
+	if (info.security != NULL && g_str_equal(info.security, "none") == FALSE)
+		gtk_widget_show(service->security);
+	else
+		gtk_widget_hide(service->security);
+
+	if (info.type == CONNMAN_TYPE_ETHERNET)
+		gtk_widget_hide(service->strength);
+	else {
+		str = g_strdup_printf("%u%%", info.strength);
+		gtk_label_set_text(GTK_LABEL(service->strength), str);
+		gtk_widget_show(service->strength);
+		g_free(str);
+	}
+
+	/* The radio shows the daemon's state, not the last click */
+	g_signal_handlers_block_by_func(service->item,
+					G_CALLBACK(item_activate), service);
+	gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(service->item),
+						is_connected(info.state));
+	g_signal_handlers_unblock_by_func(service->item,
+					G_CALLBACK(item_activate), service);
+
+	g_free(info.name);
+	g_free(info.address);
+}
+
+static void item_activate(GtkMenuItem *item, gpointer user_data)
+{
+	struct menu_service *service = user_data;
+	const gchar *state;
+
+	state = connman_client_get_state(client, service->path);
+
+	if (is_connected(state) == TRUE)
+		connman_client_disconnect_async(client, service->path,
+						call_reply, NULL);
+	else
+		connman_client_connect_async(client, service->path,
+						call_reply, NULL);
+
+	service_update(service);
+}
+
+static void service_free(gpointer user_data)
+{
+	struct menu_service *service = user_data;
+
+	gtk_widget_destroy(service->item);
+
+	g_free(service->path);
+	g_free(service);
+}
+
+/*
+ * Items follow the order of the rows in the model. New items are
+ * appended and put in place by one pass over the model once the main
+ * loop is idle, which also follows the model when a resync reorders it.
+ */
+static gboolean menu_sort(gpointer user_data)
+{
+	struct menu_service *service;
+	GList *children, *list, *order = NULL;
+	GtkTreeIter iter;
+	gboolean cont, sorted = TRUE;
+	gint position;
+
+	sort_id = 0;
+
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE) {
+		const gchar *row;
+
+		gtk_tree_model_get(model, &iter,
+				CONNMAN_COLUMN_PATH, &row, -1);
+
+		service = row ? g_hash_table_lookup(services, row) : NULL;
+		if (service != NULL)
+			order = g_list_prepend(order, service->item);
+
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	order = g_list_reverse(order);
+
+	/* The service items come first, so compare with the same prefix */
+	children = gtk_container_get_children(GTK_CONTAINER(menu));
+	for (list = order; list; list = list->next) {
+		if (children == NULL || children->data != list->data) {
+			sorted = FALSE;
+			break;
+		}
+		children = g_list_delete_link(children, children);
+	}
+	g_list_free(children);
+
+	if (sorted == FALSE) {
+		for (list = order, position = 0; list;
+					list = list->next, position++)
+			gtk_menu_reorder_child(GTK_MENU(menu), list->data,
+								position);
+	}
+
+	g_list_free(order);
+
+	return FALSE;
+}
+
+static void menu_sort_queue(void)
+{
+	if (sort_id == 0)
+		sort_id = g_idle_add(menu_sort, NULL);
+}
+
+static void rows_reordered(GtkTreeModel *tree_model, GtkTreePath *path,
+			GtkTreeIter *iter, gpointer new_order, gpointer user_data)
+{
+	menu_sort_queue();
+}
+
+static void service_new(const char *path)
+{
+	struct menu_service *service;
+	GtkWidget *hbox;
+
+	service = g_new0(struct menu_service, 1);
+	service->path = g_strdup(path);
+
+	service->item = gtk_check_menu_item_new();
+	gtk_check_menu_item_set_draw_as_radio(
+				GTK_CHECK_MENU_ITEM(service->item), TRUE);
+
+	hbox = gtk_hbox_new(FALSE, 6);
+	gtk_container_add(GTK_CONTAINER(service->item), hbox);
+
+	service->name = gtk_label_new(NULL);
+	gtk_misc_set_alignment(GTK_MISC(service->name), 0.0, 0.5);
+	gtk_label_set_ellipsize(GTK_LABEL(service->name), PANGO_ELLIPSIZE_END);
+	gtk_label_set_max_width_chars(GTK_LABEL(service->name), 32);
+	gtk_box_pack_start(GTK_BOX(hbox), service->name, TRUE, TRUE, 0);
+
+	service->security = gtk_image_new_from_stock(
+			GTK_STOCK_DIALOG_AUTHENTICATION, GTK_ICON_SIZE_MENU);
+	gtk_box_pack_start(GTK_BOX(hbox), service->security, FALSE, FALSE, 0);
+
+	service->strength = gtk_label_new(NULL);
+	gtk_box_pack_start(GTK_BOX(hbox), service->strength, FALSE, FALSE, 0);
+
+	gtk_widget_show(service->name);
+	gtk_widget_show(hbox);
+	gtk_widget_show(service->item);
+
+	g_signal_connect(service->item, "activate",
+				G_CALLBACK(item_activate), service);
+
+	/* Right after the other services, ahead of the separator */
+	gtk_menu_shell_insert(GTK_MENU_SHELL(menu), service->item,
+					g_hash_table_size(services));
+
+	g_hash_table_insert(services, service->path, service);
+
+	service_update(service);
+
+	gtk_widget_show(separator);
+}
+
+static void service_added(ConnmanClient *object, const char *path,
+							gpointer user_data)
+{
+	if (g_hash_table_lookup(services, path) != NULL)
+		return;
+
+	service_new(path);
+
+	menu_sort_queue();
+}
+
+static void service_removed(ConnmanClient *object, const char *path,
+							gpointer user_data)
+{
+	g_hash_table_remove(services, path);
+
+	if (g_hash_table_size(services) == 0)
+		gtk_widget_hide(separator);
+}
+
+static void service_changed(ConnmanClient *object, const char *path,
+					guint changed, gpointer user_data)
+{
+	struct menu_service *service;
+
+	if ((changed & MENU_CHANGED) == 0)
+		return;
+
+	service = g_hash_table_lookup(services, path);
+	if (service == NULL)
+		return;
+
+	service_update(service);
+}
+
+static gboolean add_existing(GtkTreeModel *model, GtkTreePath *path,
+					GtkTreeIter *iter, gpointer user_data)
+{
+	const gchar *object;
+	guint type;
+
+	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PATH, &object,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+	/* Walked in model order, so appending keeps the items sorted */
+	if (object != NULL && CONNMAN_TYPE_IS_SERVICE(type) == TRUE &&
+			g_hash_table_lookup(services, object) == NULL)
+		service_new(object);
+
+	return FALSE;
+}
+
+GtkWidget *menu_init(ConnmanClient *connman_client)
+{
+	client = g_object_ref(connman_client);
+
+	services = g_hash_table_new_full(g_str_hash, g_str_equal,
+							NULL, service_free);
+
+	menu = gtk_menu_new();
+	g_object_ref_sink(menu);
+
+	/* Keeps the services apart from the items the caller appends */
+	separator = gtk_separator_menu_item_new();
+	gtk_menu_shell_append(GTK_MENU_SHELL(menu), separator);
+
+	model = connman_client_get_model(client);
+	gtk_tree_model_foreach(model, add_existing, NULL);
+
+	g_signal_connect(model, "rows-reordered",
+				G_CALLBACK(rows_reordered), NULL);
+
+	g_signal_connect(client, "service-added",
+				G_CALLBACK(service_added), NULL);
+	g_signal_connect(client, "service-removed",
+				G_CALLBACK(service_removed), NULL);
+	g_signal_connect(client, "service-changed",
+				G_CALLBACK(service_changed), NULL);
+
+	return menu;
+}
+
+void menu_cleanup(void)
+{
+	if (sort_id > 0) {
+		g_source_remove(sort_id);
+		sort_id = 0;
+	}
+
+	g_signal_handlers_disconnect_by_func(model,
+				G_CALLBACK(rows_reordered), NULL);
+	g_object_unref(model);
+	model = NULL;
+
+	g_signal_handlers_disconnect_by_func(client,
+				G_CALLBACK(service_added), NULL);
+	g_signal_handlers_disconnect_by_func(client,
+				G_CALLBACK(service_removed), NULL);
+	g_signal_handlers_disconnect_by_func(client,
+				G_CALLBACK(service_changed), NULL);
+
+	g_hash_table_destroy(services);
+	services = NULL;
+
+	gtk_widget_destroy(menu);
+	g_object_unref(menu);
+	menu = NULL;
+
+	g_object_unref(client);
+	client = NULL;
+}
@@ -25,38 +25,131 @@
 
 #include <gtk/gtk.h>
 
+#include "connman-profile.h"
+#include "connman-probe.h"
+
 #include "status.h"
 
 static gboolean available = FALSE;
 
 static GtkStatusIcon *statusicon = NULL;
 
-static GdkPixbuf *pixbuf_load(GtkIconTheme *icontheme, const gchar *name)
+/* Size used until the tray tells us otherwise */
+#define ICON_SIZE_DEFAULT	22
+
+static GtkIconTheme *icontheme;
+static GHashTable *icon_cache = NULL;
+static gint icon_size = ICON_SIZE_DEFAULT;
+static const gchar *icon_current = NULL;
+
+/*
+ * Decoded icons, keyed by name and pixel size. Every size gets decoded
+ * at exactly that size once, so the tray never has to scale a frame.
+ * Failed loads are cached as well, to warn about a missing icon once.
+ */
+static GdkPixbuf *icon_cache_get(const gchar *name)
 {
 	GdkPixbuf *pixbuf;
 	GError *error = NULL;
+	gpointer value;
+	gchar *key;
 
-	pixbuf = gtk_icon_theme_load_icon(icontheme, name, 22, 0, &error);
+	if (name == NULL)
+		return NULL;
+
+	key = g_strdup_printf("%s@%d", name, icon_size);
+
+	if (g_hash_table_lookup_extended(icon_cache, key,
+						NULL, &value) == TRUE) {
+		g_free(key);
+		return value;
+	}
+
+	pixbuf = gtk_icon_theme_load_icon(icontheme, name, icon_size,
+					GTK_ICON_LOOKUP_FORCE_SIZE, &error);
 
 	if (pixbuf == NULL) {
 		g_warning("Missing icon %s: %s", name, error->message);
 		g_error_free(error);
 	}
 
+	g_hash_table_insert(icon_cache, key, pixbuf);
+
 	return pixbuf;
 }
 
+static void icon_cache_free(gpointer data)
+{
+	if (data != NULL)
+		g_object_unref(data);
+}
+
+/* Names passed in have to outlive the status icon */
+static void icon_set(const gchar *name)
+{
+	icon_current = name;
+
+	gtk_status_icon_set_from_pixbuf(statusicon, icon_cache_get(name));
+}
+
 typedef struct {
 	guint id;
 	guint count;
 	guint frame;
 	guint start;
 	guint end;
-	GdkPixbuf **pixbuf;
+	guint loaded;
+	guint load_id;
+	gchar **names;
 } IconAnimation;
 
-static IconAnimation *icon_animation_load(GtkIconTheme *icontheme,
-					const gchar *pattern, guint count)
+/* Frames decoded per idle iteration while the animation loads */
+#define ANIMATION_LOAD_STEP	4
+
+static void icon_animation_load_frames(IconAnimation *animation, guint count)
+{
+	while (count-- > 0 && animation->loaded < animation->count) {
+		icon_cache_get(animation->names[animation->loaded]);
+		animation->loaded++;
+	}
+
+	if (animation->loaded == animation->count)
+		connman_profile_mark(CONNMAN_PROFILE_ICONS);
+}
+
+static gboolean icon_animation_load_idle(gpointer user_data)
+{
+	IconAnimation *animation = user_data;
+
+	icon_animation_load_frames(animation, ANIMATION_LOAD_STEP);
+
+	if (animation->loaded < animation->count)
+		return TRUE;
+
+	animation->load_id = 0;
+
+	return FALSE;
+}
+
+/*
+ * Only the frames of the first animation step are needed up front, so
+ * the rest get decoded in low priority idle time while the initial
+ * D-Bus replies come in. Starting the animation early decodes whatever
+ * is still missing. The same happens again after the icon size or the
+ * theme changed.
+ */
+static void icon_animation_preload(IconAnimation *animation)
+{
+	animation->loaded = 0;
+
+	if (animation->load_id > 0)
+		return;
+
+	animation->load_id = g_idle_add_full(G_PRIORITY_LOW,
+				icon_animation_load_idle, animation, NULL);
+}
+
+static IconAnimation *icon_animation_load(const gchar *pattern, guint count)
 {
 	IconAnimation *animation;
 	unsigned int i;
@@ -66,19 +159,17 @@ static IconAnimation *icon_animation_load(GtkIconTheme *icontheme,
 	animation->frame = 0;
 	animation->count = count;
 
-	animation->pixbuf = (void *) g_new(gpointer, count);
-	if (animation->pixbuf == NULL) {
+	animation->names = g_new0(gchar *, count + 1);
+	if (animation->names == NULL) {
 		g_free(animation);
 		return NULL;
 	}
 
-	for (i = 0; i < count; i++) {
-		gchar *name = g_strdup_printf("%s-%02d", pattern, i + 1);
+	for (i = 0; i < count; i++)
+		animation->names[i] = g_strdup_printf("%s-%02d",
+							pattern, i + 1);
 
-		animation->pixbuf[i] = pixbuf_load(icontheme, name);
-
-		g_free(name);
-	}
+	icon_animation_preload(animation);
 
 	return animation;
 }
@@ -87,8 +178,7 @@ static gboolean icon_animation_timeout(gpointer data)
 {
 	IconAnimation *animation = data;
 
-	gtk_status_icon_set_from_pixbuf(statusicon,
-				animation->pixbuf[animation->frame]);
+	icon_set(animation->names[animation->frame]);
 
 	animation->frame++;
 	if (animation->frame > animation->end)
@@ -102,11 +192,13 @@ static void icon_animation_start(IconAnimation *animation,
 {
 	available = TRUE;
 
-	gtk_status_icon_set_tooltip(statusicon, NULL);
-
 	animation->start = start;
 	animation->end = (end == 0) ? animation->count - 1 : end;
 
+	if (animation->loaded <= animation->end)
+		icon_animation_load_frames(animation,
+					animation->end + 1 - animation->loaded);
+
 	if (animation->id > 0)
 		return;
 
@@ -120,8 +212,6 @@ static void icon_animation_stop(IconAnimation *animation)
 {
 	available = TRUE;
 
-	gtk_status_icon_set_tooltip(statusicon, NULL);
-
 	if (animation->id > 0)
 		g_source_remove(animation->id);
 
@@ -132,40 +222,29 @@ static void icon_animation_stop(IconAnimation *animation)
 
 static void icon_animation_free(IconAnimation *animation)
 {
-	unsigned int i;
-
 	gtk_status_icon_set_visible(statusicon, FALSE);
 
 	icon_animation_stop(animation);
 
-	gtk_status_icon_set_from_pixbuf(statusicon, NULL);
+	if (animation->load_id > 0)
+		g_source_remove(animation->load_id);
 
-	for (i = 0; i < animation->count; i++)
-		if (animation->pixbuf[i])
-			g_object_unref(animation->pixbuf[i]);
+	icon_set(NULL);
 
-	g_free(animation->pixbuf);
+	g_strfreev(animation->names);
 
 	g_free(animation);
 }
 
 static void activate_callback(GObject *object, gpointer user_data)
 {
-	StatusCallback callback = user_data;
+	GtkMenu *menu = user_data;
 	guint32 activate_time = gtk_get_current_event_time();
-	GtkWidget *menu;
-
-	if (available == FALSE)
-		return;
-
-	menu = gtk_menu_new();
 
-	if (callback == NULL || callback(GTK_MENU(menu)) == FALSE) {
-		g_object_unref(menu);
+	if (available == FALSE || menu == NULL)
 		return;
-	}
 
-	gtk_menu_popup(GTK_MENU(menu), NULL, NULL,
+	gtk_menu_popup(menu, NULL, NULL,
 			gtk_status_icon_position_menu,
 			GTK_STATUS_ICON(object), 1, activate_time);
 }
@@ -183,16 +262,95 @@ static void popup_callback(GObject *object, guint button,
 			GTK_STATUS_ICON(object), button, activate_time);
 }
 
-static GtkIconTheme *icontheme;
 static IconAnimation *animation;
-static GdkPixbuf *pixbuf_notifier;
-static GdkPixbuf *pixbuf_none;
-static GdkPixbuf *pixbuf_wired;
-static GdkPixbuf *pixbuf_signal[5];
 
-int status_init(StatusCallback activate, GtkWidget *popup)
+static const gchar *icon_notifier = "connman-notifier-unavailable";
+static const gchar *icon_none = "connman-type-none";
+static const gchar *icon_wired = "connman-type-wired";
+static const gchar *icon_signal[] = {
+	"connman-signal-01",
+	"connman-signal-02",
+	"connman-signal-03",
+	"connman-signal-04",
+	"connman-signal-05",
+};
+
+/* Drop what was decoded for the old size or theme, then redraw */
+static void icon_reload(gboolean flush)
+{
+	if (flush == TRUE)
+		g_hash_table_remove_all(icon_cache);
+
+	icon_animation_preload(animation);
+
+	if (icon_current != NULL)
+		icon_set(icon_current);
+}
+
+static gboolean size_changed_callback(GtkStatusIcon *icon, gint size,
+							gpointer user_data)
+{
+	if (size <= 0 || size == icon_size)
+		return TRUE;
+
+	icon_size = size;
+	icon_reload(FALSE);
+
+	return TRUE;
+}
+
+static void theme_changed_callback(GtkIconTheme *theme, gpointer user_data)
+{
+	icon_reload(TRUE);
+}
+
+static StatusTooltipCallback tooltip_callback = NULL;
+
+/*
+ * The tooltip is only built when the tray asks for it, so status
+ * transitions never touch it.
+ */
+static gboolean query_tooltip_callback(GtkStatusIcon *icon, gint x, gint y,
+			gboolean keyboard_mode, GtkTooltip *tooltip,
+							gpointer user_data)
+{
+	gchar *markup;
+
+	if (available == FALSE) {
+		gtk_tooltip_set_text(tooltip,
+				"Connection Manager daemon is not running");
+		return TRUE;
+	}
+
+	if (tooltip_callback == NULL)
+		return FALSE;
+
+	markup = tooltip_callback();
+	if (markup == NULL)
+		return FALSE;
+
+	gtk_tooltip_set_markup(tooltip, markup);
+	g_free(markup);
+
+	return TRUE;
+}
+
+void status_set_tooltip_callback(StatusTooltipCallback callback)
+{
+	tooltip_callback = callback;
+}
+
+static void embedded_callback(GObject *object, GParamSpec *pspec,
+							gpointer user_data)
+{
+	if (gtk_status_icon_is_embedded(statusicon) == TRUE)
+		connman_profile_mark(CONNMAN_PROFILE_PAINTED);
+}
+
+int status_init(GtkWidget *activate, GtkWidget *popup)
 {
 	GdkScreen *screen;
+	unsigned int i;
 
 	statusicon = gtk_status_icon_new();
 
@@ -204,17 +362,34 @@ int status_init(StatusCallback activate, GtkWidget *popup)
 
 	gtk_icon_theme_append_search_path(icontheme, ICONDIR);
 
-	animation = icon_animation_load(icontheme, "connman-connecting", 33);
+	icon_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, icon_cache_free);
+
+	icon_size = gtk_status_icon_get_size(statusicon);
+	if (icon_size <= 0)
+		icon_size = ICON_SIZE_DEFAULT;
+
+	/* Decode the static icons now, the animation follows in idle time */
+	icon_cache_get(icon_notifier);
+	icon_cache_get(icon_none);
+	icon_cache_get(icon_wired);
+	for (i = 0; i < G_N_ELEMENTS(icon_signal); i++)
+		icon_cache_get(icon_signal[i]);
+
+	animation = icon_animation_load("connman-connecting", 33);
 
-	pixbuf_signal[0] = pixbuf_load(icontheme, "connman-signal-01");
-	pixbuf_signal[1] = pixbuf_load(icontheme, "connman-signal-02");
-	pixbuf_signal[2] = pixbuf_load(icontheme, "connman-signal-03");
-	pixbuf_signal[3] = pixbuf_load(icontheme, "connman-signal-04");
-	pixbuf_signal[4] = pixbuf_load(icontheme, "connman-signal-05");
+	g_signal_connect(statusicon, "size-changed",
+				G_CALLBACK(size_changed_callback), NULL);
+	g_signal_connect(icontheme, "changed",
+				G_CALLBACK(theme_changed_callback), NULL);
 
-	pixbuf_none = pixbuf_load(icontheme, "connman-type-none");
-	pixbuf_wired = pixbuf_load(icontheme, "connman-type-wired");
-	pixbuf_notifier = pixbuf_load(icontheme, "connman-notifier-unavailable");
+	gtk_status_icon_set_has_tooltip(statusicon, TRUE);
+	g_signal_connect(statusicon, "query-tooltip",
+				G_CALLBACK(query_tooltip_callback), NULL);
+
+	/* The tray paints the icon as soon as it has embedded it */
+	g_signal_connect(statusicon, "notify::embedded",
+				G_CALLBACK(embedded_callback), NULL);
 
 	if (activate != NULL)
 		g_signal_connect(statusicon, "activate",
@@ -228,16 +403,13 @@ int status_init(StatusCallback activate, GtkWidget *popup)
 
 void status_cleanup(void)
 {
-	int i;
+	g_signal_handlers_disconnect_by_func(icontheme,
+				G_CALLBACK(theme_changed_callback), NULL);
 
 	icon_animation_free(animation);
 
-	for (i = 0; i < 5; i++)
-		g_object_unref(pixbuf_signal[i]);
-
-	g_object_unref(pixbuf_none);
-	g_object_unref(pixbuf_wired);
-	g_object_unref(pixbuf_notifier);
+	g_hash_table_destroy(icon_cache);
+	icon_cache = NULL;
 
 	g_object_unref(icontheme);
 
@@ -246,39 +418,45 @@ void status_cleanup(void)
 
 void status_unavailable(void)
 {
+	CONNMAN_PROBE1(status, "unavailable");
+
 	icon_animation_stop(animation);
 
 	available = FALSE;
 
-	gtk_status_icon_set_from_pixbuf(statusicon, pixbuf_notifier);
-	gtk_status_icon_set_tooltip(statusicon,
-				"Connection Manager daemon is not running");
+	icon_set(icon_notifier);
 
 	gtk_status_icon_set_visible(statusicon, TRUE);
 }
 
 void status_hide(void)
 {
+	CONNMAN_PROBE1(status, "hide");
+
 	gtk_status_icon_set_visible(statusicon, FALSE);
 
 	icon_animation_stop(animation);
 
 	available = FALSE;
 
-	gtk_status_icon_set_from_pixbuf(statusicon, NULL);
+	icon_set(NULL);
 }
 
 void status_offline(void)
 {
+	CONNMAN_PROBE1(status, "offline");
+
 	icon_animation_stop(animation);
 
-	gtk_status_icon_set_from_pixbuf(statusicon, pixbuf_none);
+	icon_set(icon_none);
 
 	gtk_status_icon_set_visible(statusicon, TRUE);
 }
 
 void status_prepare(void)
 {
+	CONNMAN_PROBE1(status, "prepare");
+
 	gtk_status_icon_set_visible(statusicon, TRUE);
 
 	icon_animation_start(animation, 0, 10);
@@ -286,6 +464,8 @@ void status_prepare(void)
 
 void status_config(void)
 {
+	CONNMAN_PROBE1(status, "config");
+
 	gtk_status_icon_set_visible(statusicon, TRUE);
 
 	icon_animation_start(animation, 11, 21);
@@ -298,8 +478,7 @@ static void set_ready(gint signal)
 	available = TRUE;
 
 	if (signal < 0) {
-		gtk_status_icon_set_from_pixbuf(statusicon, pixbuf_wired);
-		gtk_status_icon_set_tooltip(statusicon, NULL);
+		icon_set(icon_wired);
 		return;
 	}
 
@@ -310,8 +489,7 @@ static void set_ready(gint signal)
 	else
 		index = 4;
 
-	gtk_status_icon_set_from_pixbuf(statusicon, pixbuf_signal[index]);
-	gtk_status_icon_set_tooltip(statusicon, NULL);
+	icon_set(icon_signal[index]);
 }
 
 struct timeout_data {
@@ -334,6 +512,8 @@ static gboolean ready_timeout(gpointer user_data)
 
 void status_ready(gint signal)
 {
+	CONNMAN_PROBE1(status, "ready");
+
 	if (animation->id > 0) {
 		struct timeout_data *data;
 
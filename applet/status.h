@@ -19,11 +19,15 @@
  *
  */
 
-typedef gboolean (* StatusCallback) (GtkMenu *menu);
-
-int status_init(StatusCallback activate, GtkWidget *popup);
+/* Both menus are kept by the caller and shown as they are */
+int status_init(GtkWidget *activate, GtkWidget *popup);
 void status_cleanup(void);
 
+/* Returns newly allocated tooltip markup, or NULL for no tooltip */
+typedef gchar *(* StatusTooltipCallback) (void);
+
+void status_set_tooltip_callback(StatusTooltipCallback callback);
+
 void status_unavailable(void);
 void status_hide(void);
 void status_offline(void);
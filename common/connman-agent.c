@@ -22,12 +22,18 @@
  *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <dbus/dbus-glib.h>
 #include <dbus/dbus-glib-lowlevel.h>
 #include <stdio.h>
 
 #include "connman-agent.h"
 #include "connman-dbus.h"
+#include "connman-profile.h"
+#include "connman-probe.h"
 
 #define CONNMAN_AGENT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
   CONNMAN_TYPE_AGENT, ConnmanAgentPrivate))
@@ -52,6 +58,19 @@ static GQuark agent_error_quark(void)
 
 #define ENUM_ENTRY(NAME, DESC) { NAME, "" #NAME "", DESC }
 
+/*
+ * Registration never blocks: the daemon's unique name and RegisterAgent
+ * are both asynchronous calls and an attempt that fails because the
+ * daemon is absent or slow is retried with an exponential backoff.
+ *
+ * Once registered the agent follows the daemon's name owner and
+ * registers itself again whenever connmand comes back, so one agent
+ * object lives as long as the application.
+ */
+#define REGISTER_TIMEOUT	5000	/* ms */
+#define RETRY_MIN		1	/* seconds */
+#define RETRY_MAX		64
+
 typedef struct _ConnmanAgentPrivate ConnmanAgentPrivate;
 
 typedef struct _PendingRequest PendingRequest;
@@ -67,6 +86,14 @@ struct _ConnmanAgentPrivate {
 	DBusGConnection *connection;
 	DBusGProxy *connman_proxy;
 
+	DBusGProxy *dbus_proxy;
+	DBusGProxy *call_proxy;
+	DBusGProxyCall *call;
+	guint retry_id;
+	guint retry_delay;
+	gboolean active;
+	gboolean registered;
+
 	ConnmanAgentRequestInputFunc input_func;
 	gpointer input_data;
 
@@ -156,6 +183,8 @@ static gboolean connman_agent_request_input(ConnmanAgent *agent,
 
 	debug(agent, "request %s, sender %s", path, sender);
 
+	CONNMAN_PROBE1(agent_request, path);
+
 	if (fields == NULL)
 		return FALSE;
 
@@ -182,6 +211,8 @@ static gboolean connman_agent_cancel(ConnmanAgent *agent,
 
 	debug(agent, "Request Canceled %s", sender);
 
+	CONNMAN_PROBE(agent_cancel);
+
 	if (g_str_equal(sender, priv->busname) == FALSE)
 		return FALSE;
 
@@ -214,17 +245,45 @@ static void connman_agent_init(ConnmanAgent *agent)
   debug(agent, "agent %p", agent);
 }
 
+static void register_cancel(ConnmanAgentPrivate *priv)
+{
+	if (priv->call != NULL) {
+		dbus_g_proxy_cancel_call(priv->call_proxy, priv->call);
+		priv->call = NULL;
+		priv->call_proxy = NULL;
+	}
+
+	if (priv->retry_id > 0) {
+		g_source_remove(priv->retry_id);
+		priv->retry_id = 0;
+	}
+}
+
+static void name_owner_changed(DBusGProxy *proxy, const char *name,
+			const char *prev, const char *new, gpointer user_data);
+
 static void connman_agent_finalize(GObject *agent)
 {
 	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
 
+	register_cancel(priv);
+
+	if (priv->dbus_proxy != NULL)
+		dbus_g_proxy_disconnect_signal(priv->dbus_proxy,
+		                               "NameOwnerChanged",
+		                               G_CALLBACK(name_owner_changed), agent);
+
 	if (priv->connman_proxy != NULL) {
 		g_object_unref(priv->connman_proxy);
 	}
 
+	if (priv->dbus_proxy != NULL)
+		g_object_unref(priv->dbus_proxy);
+
 	g_free(priv->path);
 	g_free(priv->busname);
-	dbus_g_connection_unref(priv->connection);
+	if (priv->connection != NULL)
+		dbus_g_connection_unref(priv->connection);
 
 	G_OBJECT_CLASS(connman_agent_parent_class)->finalize(agent);
 }
@@ -254,8 +313,6 @@ ConnmanAgent *connman_agent_new(void)
 gboolean connman_agent_setup(ConnmanAgent *agent, const char *path)
 {
 	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
-	DBusGProxy *proxy;
-	GObject *object;
 	GError *error = NULL;
 
 	debug(agent, "agent_setup %p", agent);
@@ -272,90 +329,249 @@ gboolean connman_agent_setup(ConnmanAgent *agent, const char *path)
 		return FALSE;
 	}
 
-	proxy = dbus_g_proxy_new_for_name_owner(priv->connection, CONNMAN_SERVICE,
-	                                        CONNMAN_MANAGER_PATH, CONNMAN_MANAGER_INTERFACE, NULL);
+	/* The daemon's unique name is looked up when registering */
+	priv->dbus_proxy = dbus_g_proxy_new_for_name(priv->connection,
+	                                             DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+	                                             DBUS_INTERFACE_DBUS);
 
-	g_free(priv->busname);
+	dbus_g_proxy_add_signal(priv->dbus_proxy, "NameOwnerChanged",
+	                        G_TYPE_STRING, G_TYPE_STRING,
+	                        G_TYPE_STRING, G_TYPE_INVALID);
+	dbus_g_proxy_connect_signal(priv->dbus_proxy, "NameOwnerChanged",
+	                            G_CALLBACK(name_owner_changed), agent, NULL);
 
-	if (proxy != NULL) {
-		priv->busname = g_strdup(dbus_g_proxy_get_bus_name(proxy));
-		g_object_unref(proxy);
-	} else
-		priv->busname = NULL;
+	return TRUE;
+}
 
-	object = dbus_g_connection_lookup_g_object(priv->connection, priv->path);
-	if (object != NULL)
-		g_object_unref(object);
+static gboolean register_retryable(GError *error)
+{
+	if (error->domain != DBUS_GERROR)
+		return FALSE;
 
-	return TRUE;
+	switch (error->code) {
+	case DBUS_GERROR_SERVICE_UNKNOWN:
+	case DBUS_GERROR_NAME_HAS_NO_OWNER:
+	case DBUS_GERROR_NO_REPLY:
+	case DBUS_GERROR_TIMEOUT:
+		return TRUE;
+	}
+
+	return FALSE;
 }
 
+static void register_attempt(ConnmanAgent *agent);
 
-gboolean connman_agent_register(ConnmanAgent *agent)
+static gboolean register_retry(gpointer user_data)
 {
+	ConnmanAgent *agent = user_data;
 	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
-	GObject *object;
-	GError *error = NULL;
-
-	debug(agent, "register agent %p", agent);
 
-	if (priv->connman_proxy != NULL)
-		return FALSE;
+	priv->retry_id = 0;
 
-	priv->connman_proxy = dbus_g_proxy_new_for_name_owner(priv->connection, CONNMAN_SERVICE,
-	                                                      CONNMAN_MANAGER_PATH, CONNMAN_MANAGER_INTERFACE, NULL);
+	register_attempt(agent);
 
-	g_free(priv->busname);
+	return FALSE;
+}
 
-	priv->busname = g_strdup(dbus_g_proxy_get_bus_name(priv->connman_proxy));
+static void register_schedule(ConnmanAgent *agent, const char *reason)
+{
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
 
-	object = dbus_g_connection_lookup_g_object(priv->connection, priv->path);
-	if (object != NULL)
-		g_object_unref(object);
+	debug(agent, "registration failed (%s), retry in %us",
+	      reason, priv->retry_delay);
 
-	dbus_g_connection_register_g_object(priv->connection,
-	                                    priv->path, G_OBJECT(agent));
+	priv->retry_id = g_timeout_add(priv->retry_delay * 1000,
+	                               register_retry, agent);
 
-	dbus_g_proxy_call(priv->connman_proxy, "RegisterAgent", &error,
-	                  DBUS_TYPE_G_OBJECT_PATH, priv->path,
-	                  G_TYPE_INVALID, G_TYPE_INVALID);
+	priv->retry_delay = MIN(priv->retry_delay * 2, RETRY_MAX);
+}
 
-	if (error != NULL) {
+static void register_failed(ConnmanAgent *agent, GError *error)
+{
+	if (register_retryable(error) == FALSE) {
 		g_printerr("Agent registration failed: %s\n",
 		           error->message);
+		return;
+	}
+
+	register_schedule(agent, error->message);
+}
+
+/* A call that couldn't be sent at all is retried like a lost reply */
+static void register_sent(ConnmanAgent *agent)
+{
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+
+	if (priv->call != NULL)
+		return;
+
+	priv->call_proxy = NULL;
+
+	register_schedule(agent, "call not sent");
+}
+
+static void register_reply(DBusGProxy *proxy, DBusGProxyCall *call,
+                           gpointer user_data)
+{
+	ConnmanAgent *agent = user_data;
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+	GError *error = NULL;
+
+	priv->call = NULL;
+	priv->call_proxy = NULL;
+
+	if (dbus_g_proxy_end_call(proxy, call, &error,
+	                          G_TYPE_INVALID) == FALSE) {
+		register_failed(agent, error);
 		g_error_free(error);
-		return FALSE;
+		return;
+	}
+
+	debug(agent, "agent %p registered with %s", agent, priv->busname);
+
+	priv->registered = TRUE;
+
+	connman_profile_mark(CONNMAN_PROFILE_AGENT);
+}
+
+static void owner_reply(DBusGProxy *proxy, DBusGProxyCall *call,
+                        gpointer user_data)
+{
+	ConnmanAgent *agent = user_data;
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+	GError *error = NULL;
+	gchar *owner;
+
+	priv->call = NULL;
+	priv->call_proxy = NULL;
+
+	if (dbus_g_proxy_end_call(proxy, call, &error, G_TYPE_STRING,
+	                          &owner, G_TYPE_INVALID) == FALSE) {
+		register_failed(agent, error);
+		g_error_free(error);
+		return;
 	}
 
+	/* Cancel and Release are only accepted from this owner */
+	g_free(priv->busname);
+	priv->busname = owner;
+
+	if (priv->connman_proxy != NULL)
+		g_object_unref(priv->connman_proxy);
+
+	priv->connman_proxy = dbus_g_proxy_new_for_name(priv->connection,
+	                                                owner, CONNMAN_MANAGER_PATH,
+	                                                CONNMAN_MANAGER_INTERFACE);
+
+	priv->call_proxy = priv->connman_proxy;
+	priv->call = dbus_g_proxy_begin_call_with_timeout(priv->connman_proxy,
+	                                                  "RegisterAgent", register_reply,
+	                                                  agent, NULL, REGISTER_TIMEOUT,
+	                                                  DBUS_TYPE_G_OBJECT_PATH, priv->path,
+	                                                  G_TYPE_INVALID);
+
+	register_sent(agent);
+}
+
+static void register_attempt(ConnmanAgent *agent)
+{
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+
+	debug(agent, "register attempt %p", agent);
+
+	priv->call_proxy = priv->dbus_proxy;
+	priv->call = dbus_g_proxy_begin_call(priv->dbus_proxy, "GetNameOwner",
+	                                     owner_reply, agent, NULL,
+	                                     G_TYPE_STRING, CONNMAN_SERVICE,
+	                                     G_TYPE_INVALID);
+
+	register_sent(agent);
+}
+
+static void name_owner_changed(DBusGProxy *proxy, const char *name,
+			const char *prev, const char *new, gpointer user_data)
+{
+	ConnmanAgent *agent = user_data;
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+
+	if (g_str_equal(name, CONNMAN_SERVICE) == FALSE)
+		return;
+
+	if (priv->active == FALSE)
+		return;
+
+	debug(agent, "daemon owner changed from '%s' to '%s'", prev, new);
+
+	/* Whatever was in flight was addressed to the old owner */
+	register_cancel(priv);
+	priv->registered = FALSE;
+
+	if (*new == '\0')
+		return;
+
+	priv->retry_delay = RETRY_MIN;
+
+	register_attempt(agent);
+}
+
+gboolean connman_agent_register(ConnmanAgent *agent)
+{
+	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
+	GObject *object;
+
+	debug(agent, "register agent %p", agent);
+
+	if (priv->dbus_proxy == NULL)
+		return FALSE;
+
+	if (priv->registered == TRUE || priv->call != NULL ||
+	                                priv->retry_id > 0)
+		return FALSE;
+
+	object = dbus_g_connection_lookup_g_object(priv->connection, priv->path);
+	if (object == NULL)
+		dbus_g_connection_register_g_object(priv->connection,
+		                                    priv->path, G_OBJECT(agent));
+
+	priv->active = TRUE;
+	priv->retry_delay = RETRY_MIN;
+
+	register_attempt(agent);
+
 	return TRUE;
 }
 
 gboolean connman_agent_unregister(ConnmanAgent *agent)
 {
 	ConnmanAgentPrivate *priv = CONNMAN_AGENT_GET_PRIVATE(agent);
-	GError *error = NULL;
 
 	debug(agent, "unregister agent %p", agent);
 
+	register_cancel(priv);
+
+	priv->active = FALSE;
+
 	if (priv->connman_proxy == NULL)
 		return FALSE;
 
-	dbus_g_proxy_call(priv->connman_proxy, "UnregisterAgent", &error,
-	                  DBUS_TYPE_G_OBJECT_PATH, priv->path,
-	                  G_TYPE_INVALID, G_TYPE_INVALID);
+	if (priv->registered == TRUE) {
+		dbus_g_proxy_call_no_reply(priv->connman_proxy, "UnregisterAgent",
+		                           DBUS_TYPE_G_OBJECT_PATH, priv->path,
+		                           G_TYPE_INVALID);
 
-	if (error != NULL) {
-		g_printerr("Agent unregistration failed: %s\n",
-		           error->message);
-		g_error_free(error);
+		/* Callers tend to drop the connection and exit right after */
+		dbus_g_connection_flush(priv->connection);
 	}
 
+	priv->registered = FALSE;
+
 	g_object_unref(priv->connman_proxy);
 	priv->connman_proxy = NULL;
 
-	g_free(priv->path);
-	priv->path = NULL;
-
+	/*
+	 * The path and the exported object stay until finalize, so the
+	 * agent can be registered again.
+	 */
 	return TRUE;
 }
 
@@ -23,9 +23,15 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "connman-dbus.h"
 #include "connman-dbus-glue.h"
 #include "connman-client.h"
+#include "connman-trace.h"
+#include "connman-profile.h"
+#include "connman-probe.h"
+#include "connman-index.h"
 
 #include "marshal.h"
 #include "marshal.c"
@@ -44,6 +50,39 @@
 	(dbus_g_type_get_map("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
 #endif
 
+/*
+ * Signal history and connect timing are kept for a fixed number of
+ * services, with a fixed number of samples each. Recording never
+ * allocates and the memory used does not depend on how many services
+ * show up. The least recently updated service gives up its slot to a
+ * new one.
+ */
+#define STATS_SERVICES		32
+
+#define HISTOGRAM_TYPES		(CONNMAN_TYPE_CELLULAR + 1)
+#define HISTOGRAM_LIMIT		256
+
+struct attempt {
+	gint64 start;
+	gint64 since;
+	guint phase;
+	gboolean input;
+	gint64 time[_CONNMAN_NUM_PHASES];
+};
+
+struct stats {
+	gchar path[256];
+	guint64 stamp;
+	guint next;
+	guint count;
+	struct connman_sample samples[CONNMAN_HISTORY_LENGTH];
+	const gchar *state;
+	gint64 connected;
+	struct attempt attempt;
+	gboolean has_last;
+	gint64 last[_CONNMAN_NUM_PHASES];
+};
+
 typedef struct _ConnmanClientPrivate ConnmanClientPrivate;
 
 struct _ConnmanClientPrivate {
@@ -53,35 +92,84 @@ struct _ConnmanClientPrivate {
 	GHashTable *services;
 	ConnmanClientCallback callback;
 	gpointer userdata;
+	struct stats stats[STATS_SERVICES];
+	guint64 stats_stamp;
+	guint histogram[HISTOGRAM_TYPES][_CONNMAN_NUM_PHASES]
+					[CONNMAN_HISTOGRAM_BUCKETS];
+	ConnmanIndex *index;
+	GSList *searches;
+	GtkTreeStore *groups;
+	GHashTable *group_table;
+	GHashTable *members;
+};
+
+/* A row of the grouped model and the services below it */
+struct group {
+	gchar *key;
+	GtkTreeIter iter;
+	guint count;
+};
+
+struct member {
+	struct group *group;
+	GtkTreeIter iter;
+};
+
+#define GROUP_CHANGED	(CONNMAN_CHANGED(CONNMAN_COLUMN_STATE) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH))
+
+#define STATS_CHANGED	(CONNMAN_CHANGED(CONNMAN_COLUMN_STATE) | \
+			CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH))
+
+/*
+ * Search state of one device model. With no query, matches is NULL and
+ * every service is visible.
+ */
+struct device_search {
+	ConnmanClientPrivate *priv;
+	GtkTreeModel *model;
+	gchar *query;
+	GHashTable *matches;
 };
 
+/* Above this many rows changing visibility a full refilter is cheaper */
+#define SEARCH_REFILTER		64
+
 G_DEFINE_TYPE(ConnmanClient, connman_client, G_TYPE_OBJECT)
 
+enum {
+	SIGNAL_POPULATED,
+	SIGNAL_SERVICE_ADDED,
+	SIGNAL_SERVICE_REMOVED,
+	SIGNAL_SERVICE_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
 static void name_owner_changed(DBusGProxy *dbus, const char *name,
 			const char *prev, const char *new, gpointer user_data)
 {
 	ConnmanClient *client = user_data;
 	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
-	GtkTreeIter iter;
-	gboolean cont;
 	char *state, *oldstate;
 
 	if (g_str_equal(name, CONNMAN_SERVICE) == FALSE)
 		return;
 
+	DBG("client %p name %s new %s", client, name, new);
+
+	/*
+	 * The rows are kept while the daemon is away and diffed against
+	 * its state once it is back, so services that survive the restart
+	 * keep their rows, selection and open property pages.
+	 */
 	if (*new != '\0') {
+		connman_dbus_resync(priv->manager, priv->store);
 		state = "offline";
 		goto done;
 	}
 
-	DBG("client %p name %s", client, name);
-
-	cont = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(priv->store),
-									&iter);
-
-	while (cont == TRUE)
-		cont = gtk_tree_store_remove(priv->store, &iter);
-
 	state = "unavailable";
 
 done:
@@ -96,32 +184,536 @@ done:
 
 static DBusGConnection *connection = NULL;
 
+static void search_row_changed(GtkTreeStore *store, const char *path)
+{
+	GtkTreePath *treepath;
+	GtkTreeIter iter;
+
+	if (connman_dbus_get_iter(store, path, &iter) == FALSE)
+		return;
+
+	treepath = gtk_tree_model_get_path(GTK_TREE_MODEL(store), &iter);
+	gtk_tree_model_row_changed(GTK_TREE_MODEL(store), treepath, &iter);
+	gtk_tree_path_free(treepath);
+}
+
+static void search_update(ConnmanClientPrivate *priv, const char *path,
+							gboolean removed)
+{
+	GSList *list;
+
+	if (removed == TRUE)
+		connman_index_remove(priv->index, path);
+	else {
+		GtkTreeIter iter;
+		gchar *name;
+
+		if (connman_dbus_get_iter(priv->store, path, &iter) == FALSE)
+			return;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+					CONNMAN_COLUMN_NAME, &name, -1);
+		connman_index_set(priv->index, path, name ? name : "");
+		g_free(name);
+	}
+
+	for (list = priv->searches; list; list = list->next) {
+		struct device_search *search = list->data;
+		gboolean was, match;
+
+		if (search->matches == NULL)
+			continue;
+
+		was = g_hash_table_lookup(search->matches, path) != NULL;
+		match = removed == FALSE && connman_index_match(priv->index,
+						path, search->query) == TRUE;
+
+		if (match == was)
+			continue;
+
+		if (match == TRUE) {
+			gchar *key = g_strdup(path);
+			g_hash_table_insert(search->matches, key, key);
+		} else
+			g_hash_table_remove(search->matches, path);
+
+		/* The filter saw the row before the index knew about it */
+		if (removed == FALSE)
+			search_row_changed(priv->store, path);
+	}
+}
+
+static guint state_rank(const gchar *state)
+{
+	static const char *states[] = {
+		"online", "ready", "configuration", "association",
+		"idle", "disconnect", "failure",
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(states); i++)
+		if (g_strcmp0(state, states[i]) == 0)
+			return i;
+
+	return G_N_ELEMENTS(states);
+}
+
+/* Only walks the members of this one group */
+static void group_refresh(ConnmanClientPrivate *priv, struct group *group)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(priv->groups);
+	const gchar *state, *best = NULL, *old_state;
+	guint strength, max = 0, old_strength, old_count;
+	GtkTreeIter iter;
+	gboolean cont;
+
+	cont = gtk_tree_model_iter_children(model, &iter, &group->iter);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_STATE, &state,
+				CONNMAN_COLUMN_STRENGTH, &strength, -1);
+
+		if (strength > max)
+			max = strength;
+
+		if (best == NULL || state_rank(state) < state_rank(best))
+			best = state;
+
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	gtk_tree_model_get(model, &group->iter,
+				CONNMAN_COLUMN_STATE, &old_state,
+				CONNMAN_COLUMN_STRENGTH, &old_strength,
+				CONNMAN_COLUMN_CHILDREN, &old_count, -1);
+
+	if (old_state == best && old_strength == max &&
+						old_count == group->count)
+		return;
+
+	gtk_tree_store_set(priv->groups, &group->iter,
+				CONNMAN_COLUMN_STATE, best,
+				CONNMAN_COLUMN_STRENGTH, max,
+				CONNMAN_COLUMN_CHILDREN, group->count, -1);
+}
+
+static void member_copy(ConnmanClientPrivate *priv, struct member *member,
+							GtkTreeIter *iter)
+{
+	const gchar *path, *state, *security;
+	gboolean favorite;
+	guint type, strength;
+	gchar *name;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(priv->store), iter,
+				CONNMAN_COLUMN_PATH, &path,
+				CONNMAN_COLUMN_NAME, &name,
+				CONNMAN_COLUMN_TYPE, &type,
+				CONNMAN_COLUMN_STATE, &state,
+				CONNMAN_COLUMN_FAVORITE, &favorite,
+				CONNMAN_COLUMN_STRENGTH, &strength,
+				CONNMAN_COLUMN_SECURITY, &security, -1);
+
+	gtk_tree_store_set(priv->groups, &member->iter,
+				CONNMAN_COLUMN_PATH, path,
+				CONNMAN_COLUMN_NAME, name,
+				CONNMAN_COLUMN_TYPE, type,
+				CONNMAN_COLUMN_STATE, state,
+				CONNMAN_COLUMN_FAVORITE, favorite,
+				CONNMAN_COLUMN_STRENGTH, strength,
+				CONNMAN_COLUMN_SECURITY, security, -1);
+
+	g_free(name);
+}
+
+static void group_add(ConnmanClientPrivate *priv, const char *path)
+{
+	struct group *group;
+	struct member *member;
+	GtkTreeIter iter;
+	guint type;
+	gchar *name, *key;
+
+	if (g_hash_table_lookup(priv->members, path) != NULL)
+		return;
+
+	if (connman_dbus_get_iter(priv->store, path, &iter) == FALSE)
+		return;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+				CONNMAN_COLUMN_NAME, &name,
+				CONNMAN_COLUMN_TYPE, &type, -1);
+
+	key = g_strdup_printf("%u:%s", type, name ? name : "");
+
+	group = g_hash_table_lookup(priv->group_table, key);
+	if (group == NULL) {
+		group = g_new0(struct group, 1);
+		group->key = key;
+
+		gtk_tree_store_insert_with_values(priv->groups, &group->iter,
+					NULL, -1,
+					CONNMAN_COLUMN_NAME, name,
+					CONNMAN_COLUMN_TYPE, type, -1);
+
+		g_hash_table_insert(priv->group_table, group->key, group);
+	} else
+		g_free(key);
+
+	g_free(name);
+
+	member = g_new0(struct member, 1);
+	member->group = group;
+
+	gtk_tree_store_append(priv->groups, &member->iter, &group->iter);
+	member_copy(priv, member, &iter);
+
+	g_hash_table_insert(priv->members, g_strdup(path), member);
+
+	group->count++;
+	group_refresh(priv, group);
+}
+
+static void group_remove(ConnmanClientPrivate *priv, const char *path)
+{
+	struct member *member;
+	struct group *group;
+
+	member = g_hash_table_lookup(priv->members, path);
+	if (member == NULL)
+		return;
+
+	group = member->group;
+
+	gtk_tree_store_remove(priv->groups, &member->iter);
+	g_hash_table_remove(priv->members, path);
+
+	group->count--;
+	if (group->count > 0) {
+		group_refresh(priv, group);
+		return;
+	}
+
+	gtk_tree_store_remove(priv->groups, &group->iter);
+	g_hash_table_remove(priv->group_table, group->key);
+}
+
+static void group_changed(ConnmanClientPrivate *priv, const char *path,
+							guint changed)
+{
+	struct member *member;
+	GtkTreeIter iter;
+
+	/* A new name or type means a different group */
+	if (changed & (CONNMAN_CHANGED(CONNMAN_COLUMN_NAME) |
+				CONNMAN_CHANGED(CONNMAN_COLUMN_TYPE))) {
+		group_remove(priv, path);
+		group_add(priv, path);
+		return;
+	}
+
+	member = g_hash_table_lookup(priv->members, path);
+	if (member == NULL) {
+		group_add(priv, path);
+		return;
+	}
+
+	if (connman_dbus_get_iter(priv->store, path, &iter) == FALSE)
+		return;
+
+	member_copy(priv, member, &iter);
+
+	if (changed & GROUP_CHANGED)
+		group_refresh(priv, member->group);
+}
+
+static void group_free(gpointer data)
+{
+	struct group *group = data;
+
+	g_free(group->key);
+	g_free(group);
+}
+
+static void stats_update(ConnmanClientPrivate *priv, const gchar *path);
+static void stats_release(ConnmanClientPrivate *priv, const gchar *path);
+
+static void manager_notify(guint event, const char *path,
+					guint changed, gpointer user_data)
+{
+	ConnmanClient *client = user_data;
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+
+	DBG("client %p event %u path %s changed 0x%x",
+					client, event, path, changed);
+
+	switch (event) {
+	case CONNMAN_DBUS_POPULATED:
+		connman_profile_mark(CONNMAN_PROFILE_POPULATED);
+		g_signal_emit(client, signals[SIGNAL_POPULATED], 0);
+		break;
+	case CONNMAN_DBUS_SERVICE_ADDED:
+		stats_update(priv, path);
+		search_update(priv, path, FALSE);
+		if (priv->groups != NULL)
+			group_add(priv, path);
+		g_signal_emit(client, signals[SIGNAL_SERVICE_ADDED], 0, path);
+		break;
+	case CONNMAN_DBUS_SERVICE_REMOVED:
+		stats_release(priv, path);
+		search_update(priv, path, TRUE);
+		if (priv->groups != NULL)
+			group_remove(priv, path);
+		g_signal_emit(client, signals[SIGNAL_SERVICE_REMOVED], 0, path);
+		break;
+	case CONNMAN_DBUS_SERVICE_CHANGED:
+		if (changed & STATS_CHANGED)
+			stats_update(priv, path);
+		if (changed & CONNMAN_CHANGED(CONNMAN_COLUMN_NAME))
+			search_update(priv, path, FALSE);
+		if (priv->groups != NULL)
+			group_changed(priv, path, changed);
+		g_signal_emit(client, signals[SIGNAL_SERVICE_CHANGED], 0,
+								path, changed);
+		break;
+	}
+}
+
+/* Slots whose attempt is still timed or whose service is connected */
+static gboolean stats_pinned(struct stats *stats)
+{
+	return stats->attempt.start != 0 || stats->connected != 0;
+}
+
+/*
+ * The stamp is bumped by every State or Strength notification and when
+ * a connect starts, so with more services than slots the least recently
+ * touched one may well be the connected service, idle on a steady
+ * signal, or one being connected. Pinned slots are only reused when all
+ * of them are pinned.
+ */
+static struct stats *stats_lookup(ConnmanClientPrivate *priv,
+					const gchar *path, gboolean create)
+{
+	struct stats *stats, *oldest = NULL, *unpinned = NULL;
+	guint i;
+
+	for (i = 0; i < STATS_SERVICES; i++) {
+		stats = &priv->stats[i];
+
+		if (g_str_equal(stats->path, path) == TRUE)
+			return stats;
+
+		if (oldest == NULL || stats->stamp < oldest->stamp)
+			oldest = stats;
+
+		if (stats_pinned(stats) == FALSE && (unpinned == NULL ||
+					stats->stamp < unpinned->stamp))
+			unpinned = stats;
+	}
+
+	if (create == FALSE)
+		return NULL;
+
+	if (unpinned != NULL)
+		oldest = unpinned;
+
+	memset(oldest, 0, sizeof(*oldest));
+	g_strlcpy(oldest->path, path, sizeof(oldest->path));
+
+	return oldest;
+}
+
+static gint64 current_time(void)
+{
+	GTimeVal now;
+
+	g_get_current_time(&now);
+
+	return (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec;
+}
+
+static void history_record(struct stats *stats, const gchar *state,
+						guint strength, gint64 now)
+{
+	struct connman_sample *sample;
+
+	/* Only record the samples where strength or state moved */
+	if (stats->count > 0) {
+		sample = &stats->samples[(stats->next +
+				CONNMAN_HISTORY_LENGTH - 1) %
+						CONNMAN_HISTORY_LENGTH];
+		if (sample->strength == strength && sample->state == state)
+			return;
+	}
+
+	sample = &stats->samples[stats->next];
+	sample->time = now;
+	sample->state = state;
+	sample->strength = strength;
+
+	stats->next = (stats->next + 1) % CONNMAN_HISTORY_LENGTH;
+	if (stats->count < CONNMAN_HISTORY_LENGTH)
+		stats->count++;
+}
+
+static void attempt_accrue(struct attempt *attempt, gint64 now)
+{
+	if (attempt->start == 0)
+		return;
+
+	attempt->time[attempt->input == TRUE ?
+			CONNMAN_PHASE_INPUT : attempt->phase] +=
+							now - attempt->since;
+	attempt->since = now;
+}
+
+static void attempt_start(struct attempt *attempt, guint phase, gint64 now)
+{
+	memset(attempt, 0, sizeof(*attempt));
+
+	attempt->start = now;
+	attempt->since = now;
+	attempt->phase = phase;
+}
+
+static void histogram_add(guint *histogram, gint64 usec)
+{
+	guint i, bucket = 0, total = 0;
+	gint64 msec = usec / 1000;
+
+	while (bucket < CONNMAN_HISTOGRAM_BUCKETS - 1 &&
+					msec >= ((gint64) 1 << bucket))
+		bucket++;
+
+	histogram[bucket]++;
+
+	for (i = 0; i < CONNMAN_HISTOGRAM_BUCKETS; i++)
+		total += histogram[i];
+
+	/* Let old attempts fade out so the histogram keeps rolling */
+	if (total >= HISTOGRAM_LIMIT) {
+		for (i = 0; i < CONNMAN_HISTOGRAM_BUCKETS; i++)
+			histogram[i] /= 2;
+	}
+}
+
+static void timing_record(ConnmanClientPrivate *priv, struct stats *stats,
+				guint type, const gchar *state, gint64 now)
+{
+	struct attempt *attempt = &stats->attempt;
+	guint i;
+
+	if (state == stats->state)
+		return;
+
+	stats->state = state;
+
+	if (g_strcmp0(state, "ready") == 0 || g_strcmp0(state, "online") == 0) {
+		if (stats->connected == 0)
+			stats->connected = now;
+	} else
+		stats->connected = 0;
+
+	attempt_accrue(attempt, now);
+
+	if (g_strcmp0(state, "association") == 0) {
+		if (attempt->start == 0)
+			attempt_start(attempt, CONNMAN_PHASE_ASSOCIATION, now);
+		attempt->phase = CONNMAN_PHASE_ASSOCIATION;
+	} else if (g_strcmp0(state, "configuration") == 0) {
+		if (attempt->start == 0)
+			attempt_start(attempt,
+					CONNMAN_PHASE_CONFIGURATION, now);
+		attempt->phase = CONNMAN_PHASE_CONFIGURATION;
+	} else if (g_strcmp0(state, "ready") == 0 ||
+				g_strcmp0(state, "online") == 0) {
+		if (attempt->start == 0)
+			return;
+
+		attempt->time[CONNMAN_PHASE_TOTAL] = now - attempt->start;
+
+		for (i = 0; i < _CONNMAN_NUM_PHASES; i++) {
+			stats->last[i] = attempt->time[i];
+			histogram_add(priv->histogram[type][i],
+							attempt->time[i]);
+		}
+
+		stats->has_last = TRUE;
+		attempt->start = 0;
+	} else
+		attempt->start = 0;
+}
+
+/*
+ * Fed from the manager's notifications rather than the store's row
+ * signals, so strength held back from the store still gets recorded.
+ */
+static void stats_update(ConnmanClientPrivate *priv, const gchar *path)
+{
+	struct stats *stats;
+	const gchar *state;
+	guint type, strength;
+	GtkTreeIter iter;
+	gint64 now;
+
+	if (connman_dbus_get_iter(priv->store, path, &iter) == FALSE)
+		return;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+					CONNMAN_COLUMN_TYPE, &type,
+					CONNMAN_COLUMN_STATE, &state, -1);
+
+	if (type >= HISTOGRAM_TYPES ||
+		connman_dbus_get_strength(priv->store, path, &strength) == FALSE)
+		return;
+
+	stats = stats_lookup(priv, path, TRUE);
+	now = current_time();
+
+	history_record(stats, state, strength, now);
+	timing_record(priv, stats, type, state, now);
+
+	stats->stamp = ++priv->stats_stamp;
+}
+
+/*
+ * A removed service gets no more state changes to close its attempt or
+ * end its connection, so its slot is unpinned here. The samples stay
+ * in case it comes back.
+ */
+static void stats_release(ConnmanClientPrivate *priv, const gchar *path)
+{
+	struct stats *stats = stats_lookup(priv, path, FALSE);
+
+	if (stats == NULL)
+		return;
+
+	stats->attempt.start = 0;
+	stats->connected = 0;
+	stats->state = NULL;
+}
+
+static void connect_started(ConnmanClientPrivate *priv, const gchar *network)
+{
+	struct stats *stats = stats_lookup(priv, network, TRUE);
+
+	attempt_start(&stats->attempt, CONNMAN_PHASE_REQUEST, current_time());
+	stats->stamp = ++priv->stats_stamp;
+}
+
 static void connman_client_init(ConnmanClient *client)
 {
 	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
 
 	DBG("client %p", client);
 
-	priv->store = gtk_tree_store_new(_CONNMAN_NUM_COLUMNS,
-				G_TYPE_OBJECT,	/* proxy */
-				G_TYPE_UINT,	/* index */
-				G_TYPE_STRING,	/* name */
-				G_TYPE_STRING,	/* icon */
-				G_TYPE_UINT,	/* type */
-				G_TYPE_STRING,	/* state */
-				G_TYPE_BOOLEAN,	/* favorite */
-				G_TYPE_UINT,	/* strength */
-				G_TYPE_STRING,	/* security */
-				G_TYPE_STRING,  /* method */
-				G_TYPE_STRING,  /* address */
-				G_TYPE_STRING,  /* netmask */
-				G_TYPE_STRING,  /* gateway */
-				G_TYPE_BOOLEAN, /* powered */
-				G_TYPE_BOOLEAN);/* offline */
+	priv->store = connman_dbus_store_new();
 
 	g_object_set_data(G_OBJECT(priv->store),
 					"State", g_strdup("unavailable"));
 
+	priv->index = connman_index_new();
+
 	priv->dbus = dbus_g_proxy_new_for_name(connection, DBUS_SERVICE_DBUS,
 				DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
 
@@ -131,12 +723,17 @@ static void connman_client_init(ConnmanClient *client)
 	dbus_g_proxy_connect_signal(priv->dbus, "NameOwnerChanged",
 				G_CALLBACK(name_owner_changed), client, NULL);
 
-	priv->manager = connman_dbus_create_manager(connection, priv->store);
+	if (g_getenv("CONNMAN_TRACE") != NULL)
+		connman_trace_start(connection, g_getenv("CONNMAN_TRACE"));
+
+	priv->manager = connman_dbus_create_manager(connection, priv->store,
+						manager_notify, client);
 }
 
 static void connman_client_finalize(GObject *client)
 {
 	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	GSList *list;
 
 	DBG("client %p", client);
 
@@ -146,6 +743,23 @@ static void connman_client_finalize(GObject *client)
 
 	connman_dbus_destroy_manager(priv->manager, priv->store);
 
+	connman_trace_stop();
+
+	/* Device models may outlive the client, they just stop searching */
+	for (list = priv->searches; list; list = list->next) {
+		struct device_search *search = list->data;
+		search->priv = NULL;
+	}
+	g_slist_free(priv->searches);
+
+	connman_index_free(priv->index);
+
+	if (priv->groups != NULL) {
+		g_hash_table_destroy(priv->members);
+		g_hash_table_destroy(priv->group_table);
+		g_object_unref(priv->groups);
+	}
+
 	g_object_unref(priv->store);
 
 	G_OBJECT_CLASS(connman_client_parent_class)->finalize(client);
@@ -162,6 +776,31 @@ static void connman_client_class_init(ConnmanClientClass *klass)
 
 	object_class->finalize = connman_client_finalize;
 
+	signals[SIGNAL_POPULATED] = g_signal_new("populated",
+					G_TYPE_FROM_CLASS(klass),
+					G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+					g_cclosure_marshal_VOID__VOID,
+					G_TYPE_NONE, 0);
+
+	signals[SIGNAL_SERVICE_ADDED] = g_signal_new("service-added",
+					G_TYPE_FROM_CLASS(klass),
+					G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+					g_cclosure_marshal_VOID__STRING,
+					G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	signals[SIGNAL_SERVICE_REMOVED] = g_signal_new("service-removed",
+					G_TYPE_FROM_CLASS(klass),
+					G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+					g_cclosure_marshal_VOID__STRING,
+					G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	signals[SIGNAL_SERVICE_CHANGED] = g_signal_new("service-changed",
+					G_TYPE_FROM_CLASS(klass),
+					G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+					marshal_VOID__STRING_UINT,
+					G_TYPE_NONE, 2, G_TYPE_STRING,
+					G_TYPE_UINT);
+
 	dbus_g_object_register_marshaller(marshal_VOID__STRING_BOXED,
 						G_TYPE_NONE, G_TYPE_STRING,
 						G_TYPE_VALUE, G_TYPE_INVALID);
@@ -172,7 +811,8 @@ static void connman_client_class_init(ConnmanClientClass *klass)
 		g_printerr("Connecting to system bus failed: %s\n",
 							error->message);
 		g_error_free(error);
-	}
+	} else
+		connman_profile_mark(CONNMAN_PROFILE_BUS);
 }
 
 static ConnmanClient *connman_client = NULL;
@@ -187,7 +827,137 @@ ConnmanClient *connman_client_new(void)
 
 	DBG("client %p", connman_client);
 
-	return connman_client;
+	return connman_client;
+}
+
+guint connman_client_get_history(ConnmanClient *client, const gchar *network,
+			struct connman_sample *samples, guint length)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct stats *stats;
+	guint i, count, first;
+
+	DBG("client %p", client);
+
+	if (network == NULL)
+		return 0;
+
+	stats = stats_lookup(priv, network, FALSE);
+	if (stats == NULL)
+		return 0;
+
+	count = MIN(stats->count, length);
+	first = (stats->next + CONNMAN_HISTORY_LENGTH - count) %
+						CONNMAN_HISTORY_LENGTH;
+
+	for (i = 0; i < count; i++)
+		samples[i] = stats->samples[(first + i) %
+						CONNMAN_HISTORY_LENGTH];
+
+	return count;
+}
+
+gboolean connman_client_get_service_info(ConnmanClient *client,
+		const gchar *network, struct connman_service_info *info)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct stats *stats;
+	GtkTreeIter iter;
+
+	DBG("client %p", client);
+
+	memset(info, 0, sizeof(*info));
+
+	if (network == NULL)
+		return FALSE;
+
+	if (connman_dbus_get_iter(priv->store, network, &iter) == FALSE)
+		return FALSE;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+				CONNMAN_COLUMN_NAME, &info->name,
+				CONNMAN_COLUMN_TYPE, &info->type,
+				CONNMAN_COLUMN_STATE, &info->state,
+				CONNMAN_COLUMN_SECURITY, &info->security,
+				CONNMAN_COLUMN_ADDRESS, &info->address, -1);
+
+	connman_dbus_get_strength(priv->store, network, &info->strength);
+
+	stats = stats_lookup(priv, network, FALSE);
+	if (stats != NULL)
+		info->connected = stats->connected;
+
+	return TRUE;
+}
+
+gboolean connman_client_get_last_connect(ConnmanClient *client,
+				const gchar *network, gint64 *phases)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct stats *stats;
+
+	DBG("client %p", client);
+
+	if (network == NULL)
+		return FALSE;
+
+	stats = stats_lookup(priv, network, FALSE);
+	if (stats == NULL || stats->has_last == FALSE)
+		return FALSE;
+
+	memcpy(phases, stats->last, sizeof(stats->last));
+
+	return TRUE;
+}
+
+gboolean connman_client_get_histogram(ConnmanClient *client, guint type,
+					guint phase, guint *buckets)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+
+	DBG("client %p type %d phase %d", client, type, phase);
+
+	if (type >= HISTOGRAM_TYPES || phase >= _CONNMAN_NUM_PHASES)
+		return FALSE;
+
+	memcpy(buckets, priv->histogram[type][phase],
+				sizeof(priv->histogram[type][phase]));
+
+	return TRUE;
+}
+
+void connman_client_set_input_pending(ConnmanClient *client,
+				const gchar *network, gboolean pending)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct stats *stats;
+	gint64 now = current_time();
+
+	DBG("client %p network %s pending %d", client, network, pending);
+
+	if (network == NULL)
+		return;
+
+	stats = stats_lookup(priv, network, FALSE);
+	if (stats == NULL)
+		return;
+
+	attempt_accrue(&stats->attempt, now);
+	stats->attempt.input = pending;
+}
+
+gboolean connman_client_is_populated(ConnmanClient *client)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+
+	return connman_dbus_is_populated(priv->store);
+}
+
+guint connman_client_get_suppressed_writes(ConnmanClient *client)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+
+	return connman_dbus_get_suppressed(priv->store);
 }
 
 GtkTreeModel *connman_client_get_model(ConnmanClient *client)
@@ -207,14 +977,50 @@ GtkTreeModel *connman_client_get_connection_model(ConnmanClient *client)
 	return connman_client_get_model(client);
 }
 
+static gboolean group_existing(GtkTreeModel *model, GtkTreePath *path,
+					GtkTreeIter *iter, gpointer user_data)
+{
+	ConnmanClientPrivate *priv = user_data;
+	const gchar *object;
+	guint type;
+
+	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PATH, &object,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+	if (object != NULL && CONNMAN_TYPE_IS_SERVICE(type) == TRUE)
+		group_add(priv, object);
+
+	return FALSE;
+}
+
+GtkTreeModel *connman_client_get_grouped_model(ConnmanClient *client)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+
+	DBG("client %p", client);
+
+	if (priv->groups == NULL) {
+		priv->groups = connman_dbus_store_new();
+		priv->group_table = g_hash_table_new_full(g_str_hash,
+					g_str_equal, NULL, group_free);
+		priv->members = g_hash_table_new_full(g_str_hash,
+					g_str_equal, g_free, g_free);
+
+		gtk_tree_model_foreach(GTK_TREE_MODEL(priv->store),
+						group_existing, priv);
+	}
+
+	return g_object_ref(priv->groups);
+}
+
 static gboolean device_filter(GtkTreeModel *model,
 		GtkTreeIter *iter, gpointer user_data)
 {
-	DBusGProxy *proxy;
-	gboolean active;
+	struct device_search *search = user_data;
+	const gchar *object;
 	guint type;
 
-	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PROXY, &proxy,
+	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PATH, &object,
 					CONNMAN_COLUMN_TYPE, &type,
 					-1);
 
@@ -226,32 +1032,168 @@ static gboolean device_filter(GtkTreeModel *model,
 		return TRUE;
 	}
 
-	if (proxy == NULL)
+	if (object == NULL)
 		return FALSE;
 
-	active = g_str_equal(CONNMAN_SERVICE_INTERFACE,
-			dbus_g_proxy_get_interface(proxy));
+	if (search->matches == NULL)
+		return TRUE;
+
+	return g_hash_table_lookup(search->matches, object) != NULL;
+}
 
-	g_object_unref(proxy);
+static void device_search_free(gpointer user_data)
+{
+	struct device_search *search = user_data;
 
-	return active;
+	if (search->priv != NULL)
+		search->priv->searches = g_slist_remove(search->priv->searches,
+								search);
+
+	if (search->matches != NULL)
+		g_hash_table_destroy(search->matches);
+
+	g_free(search->query);
+	g_free(search);
 }
 
 GtkTreeModel *connman_client_get_device_model(ConnmanClient *client)
 {
 	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct device_search *search;
 	GtkTreeModel *model;
 
 	DBG("client %p", client);
 
 	model = gtk_tree_model_filter_new(GTK_TREE_MODEL(priv->store), NULL);
 
+	search = g_new0(struct device_search, 1);
+	search->priv = priv;
+	search->model = model;
+
+	priv->searches = g_slist_prepend(priv->searches, search);
+
 	gtk_tree_model_filter_set_visible_func(GTK_TREE_MODEL_FILTER(model),
-			device_filter, NULL, NULL);
+			device_filter, search, device_search_free);
 
 	return model;
 }
 
+static void search_delta(GHashTable *from, GHashTable *to, GSList **delta,
+								guint *count)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init(&iter, from);
+	while (*count <= SEARCH_REFILTER &&
+			g_hash_table_iter_next(&iter, &key, NULL) == TRUE) {
+		if (g_hash_table_lookup(to, key) != NULL)
+			continue;
+
+		*delta = g_slist_prepend(*delta, key);
+		(*count)++;
+	}
+}
+
+void connman_client_search(ConnmanClient *client, GtkTreeModel *model,
+							const gchar *text)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	struct device_search *search = NULL;
+	GHashTable *matches, *old;
+	GSList *list, *delta = NULL;
+	guint count = 0;
+
+	DBG("client %p model %p text %s", client, model, text);
+
+	for (list = priv->searches; list; list = list->next) {
+		struct device_search *item = list->data;
+
+		if (item->model == model) {
+			search = item;
+			break;
+		}
+	}
+
+	if (search == NULL)
+		return;
+
+	if (text != NULL && *text == '\0')
+		text = NULL;
+
+	if (g_strcmp0(search->query, text) == 0)
+		return;
+
+	matches = connman_index_lookup(priv->index, text);
+
+	/*
+	 * Only the rows that appear or disappear need to be looked at
+	 * again. Going from or to an empty query touches nearly all of
+	 * them, so that, like any large change, is left to a refilter.
+	 */
+	if (search->matches != NULL && matches != NULL) {
+		search_delta(search->matches, matches, &delta, &count);
+		search_delta(matches, search->matches, &delta, &count);
+	} else
+		count = SEARCH_REFILTER + 1;
+
+	old = search->matches;
+	search->matches = matches;
+
+	g_free(search->query);
+	search->query = g_strdup(text);
+
+	if (count > SEARCH_REFILTER)
+		gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(model));
+	else {
+		for (list = delta; list; list = list->next)
+			search_row_changed(priv->store, list->data);
+	}
+
+	g_slist_free(delta);
+
+	if (old != NULL)
+		g_hash_table_destroy(old);
+}
+
+void connman_client_set_visible_range(ConnmanClient *client,
+		GtkTreeModel *model, GtkTreePath *start, GtkTreePath *end)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	GHashTable *paths;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	const gchar *object;
+	gboolean cont;
+
+	DBG("client %p model %p", client, model);
+
+	if (model == NULL || start == NULL || end == NULL) {
+		connman_dbus_set_visible(priv->store, NULL);
+		return;
+	}
+
+	paths = g_hash_table_new(g_str_hash, g_str_equal);
+
+	cont = gtk_tree_model_get_iter(model, &iter, start);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter,
+					CONNMAN_COLUMN_PATH, &object, -1);
+
+		if (object != NULL)
+			g_hash_table_insert(paths, (gpointer) object, NULL);
+
+		path = gtk_tree_model_get_path(model, &iter);
+		cont = gtk_tree_path_compare(path, end) < 0;
+		gtk_tree_path_free(path);
+
+		if (cont == TRUE)
+			cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	connman_dbus_set_visible(priv->store, paths);
+}
+
 static void hash_table_value_string_insert( GHashTable *hash, gpointer key, const char *str )
 {
 	GValue *itemvalue;
@@ -262,6 +1204,20 @@ static void hash_table_value_string_insert( GHashTable *hash, gpointer key, cons
 	g_hash_table_insert(hash, key, itemvalue);
 }
 
+static GHashTable *ipv4_config_to_hash(struct ipv4_config *ipv4_config)
+{
+	GHashTable *ipv4 = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+	hash_table_value_string_insert(ipv4, "Method", ipv4_config->method);
+	if( g_strcmp0(ipv4_config->method, "dhcp" ) != 0 ) {
+		hash_table_value_string_insert(ipv4, "Address", ipv4_config->address);
+		hash_table_value_string_insert(ipv4, "Netmask", ipv4_config->netmask);
+		hash_table_value_string_insert(ipv4, "Gateway", ipv4_config->gateway);
+	}
+
+	return ipv4;
+}
+
 gboolean connman_client_set_ipv4(ConnmanClient *client, const gchar *device,
 				struct ipv4_config *ipv4_config)
 {
@@ -269,7 +1225,6 @@ gboolean connman_client_set_ipv4(ConnmanClient *client, const gchar *device,
 	DBusGProxy *proxy;
 	GValue value = { 0 };
 	gboolean ret;
-	GHashTable *ipv4 = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
 
 	DBG("client %p", client);
 
@@ -280,15 +1235,10 @@ gboolean connman_client_set_ipv4(ConnmanClient *client, const gchar *device,
 	if (proxy == NULL)
 		return FALSE;
 
-	hash_table_value_string_insert(ipv4, "Method", ipv4_config->method);
-	if( g_strcmp0(ipv4_config->method, "dhcp" ) != 0 ) {
-		hash_table_value_string_insert(ipv4, "Address", ipv4_config->address);
-		hash_table_value_string_insert(ipv4, "Netmask", ipv4_config->netmask);
-		hash_table_value_string_insert(ipv4, "Gateway", ipv4_config->gateway);
-	}
-
 	g_value_init(&value, DBUS_TYPE_G_DICTIONARY);
-	g_value_set_boxed(&value, ipv4);
+	g_value_set_boxed(&value, ipv4_config_to_hash(ipv4_config));
+	CONNMAN_PROBE2(call, "SetProperty", device);
+
 	ret = connman_set_property(proxy, "IPv4.Configuration", &value, NULL);
 
 	g_object_unref(proxy);
@@ -316,6 +1266,8 @@ void connman_client_set_powered(ConnmanClient *client, const gchar *device,
 	g_value_init(&value, G_TYPE_BOOLEAN);
 	g_value_set_boolean(&value, powered);
 
+	CONNMAN_PROBE2(call, "SetProperty", device);
+
 	error = NULL;
 	connman_set_property(proxy, "Powered", &value, &error);
 	if( error )
@@ -324,6 +1276,44 @@ void connman_client_set_powered(ConnmanClient *client, const gchar *device,
 	g_object_unref(proxy);
 }
 
+/*
+ * Proxies come from a pool that may drop them at any time, and a
+ * proxy that goes away cancels its pending calls. The asynchronous
+ * calls therefore keep their reference until the reply has arrived.
+ */
+struct async_call {
+	gpointer callback;
+	gpointer user_data;
+};
+
+static struct async_call *async_call_new(gpointer callback,
+							gpointer user_data)
+{
+	struct async_call *call;
+
+	call = g_new0(struct async_call, 1);
+	call->callback = callback;
+	call->user_data = user_data;
+
+	return call;
+}
+
+static void scan_reply(DBusGProxy *proxy, GError *error, gpointer user_data)
+{
+	struct async_call *call = user_data;
+	connman_scan_reply callback = call->callback;
+
+	CONNMAN_PROBE2(reply, "Scan", dbus_g_proxy_get_path(proxy));
+
+	if (callback != NULL)
+		callback(proxy, error, call->user_data);
+	else if (error != NULL)
+		g_error_free(error);
+
+	g_object_unref(proxy);
+	g_free(call);
+}
+
 void connman_client_scan(ConnmanClient *client, const gchar *device,
 						connman_scan_reply callback, gpointer user_data)
 {
@@ -339,9 +1329,10 @@ void connman_client_scan(ConnmanClient *client, const gchar *device,
 	if (proxy == NULL)
 		return;
 
-	connman_scan_async(proxy, callback, user_data);
+	CONNMAN_PROBE2(call, "Scan", device);
 
-	g_object_unref(proxy);
+	connman_scan_async(proxy, scan_reply,
+				async_call_new(callback, user_data));
 }
 
 gboolean connman_client_get_offline_status(ConnmanClient *client)
@@ -375,32 +1366,57 @@ void connman_client_set_offlinemode(ConnmanClient *client, gboolean status)
 	g_value_init(&value, G_TYPE_BOOLEAN);
 	g_value_set_boolean(&value, status);
 
+	CONNMAN_PROBE2(call, "SetProperty", CONNMAN_MANAGER_PATH);
+
 	connman_set_property(priv->manager, "OfflineMode", &value, NULL);
 }
 
+static void disconnect_reply(DBusGProxy *proxy, GError *error,
+							gpointer user_data)
+{
+	struct async_call *call = user_data;
+	connman_disconnect_reply callback = call->callback;
+
+	CONNMAN_PROBE2(reply, "Disconnect", dbus_g_proxy_get_path(proxy));
+
+	if (callback != NULL)
+		callback(proxy, error, call->user_data);
+	else if (error != NULL)
+		g_error_free(error);
+
+	g_object_unref(proxy);
+	g_free(call);
+}
+
 static gboolean network_disconnect(GtkTreeModel *model, GtkTreePath *path,
 					GtkTreeIter *iter, gpointer user_data)
 {
 	DBusGProxy *proxy;
-	char *name;
+	const gchar *object;
 	guint type;
 
-	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PROXY, &proxy,
-					CONNMAN_COLUMN_NAME, &name,
+	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_PATH, &object,
 					CONNMAN_COLUMN_TYPE, &type,
 					-1);
 
-	if (proxy == NULL)
+	if (object == NULL)
 		return TRUE;
 
-	if (g_str_equal(dbus_g_proxy_get_interface(proxy),
-					CONNMAN_SERVICE_INTERFACE) == FALSE)
+	if (CONNMAN_TYPE_IS_SERVICE(type) == FALSE)
 		return TRUE;
 
-	if (type == CONNMAN_TYPE_WIFI)
-		connman_disconnect(proxy, NULL);
+	if (type != CONNMAN_TYPE_WIFI)
+		return FALSE;
 
-	g_object_unref(proxy);
+	proxy = connman_dbus_get_proxy(GTK_TREE_STORE(model), object);
+	if (proxy == NULL)
+		return FALSE;
+
+	CONNMAN_PROBE2(call, "Disconnect", object);
+
+	/* Sent ahead of the Connect, so the daemon sees them in order */
+	connman_disconnect_async(proxy, disconnect_reply,
+					async_call_new(NULL, NULL));
 
 	return FALSE;
 }
@@ -422,11 +1438,32 @@ void connman_client_connect(ConnmanClient *client, const gchar *network)
 	if (proxy == NULL)
 		return;
 
+	connect_started(priv, network);
+
+	CONNMAN_PROBE2(call, "Connect", network);
+
 	connman_connect(proxy, NULL);
 
 	g_object_unref(proxy);
 }
 
+static void connect_reply(DBusGProxy *proxy, GError *error,
+							gpointer user_data)
+{
+	struct async_call *call = user_data;
+	connman_connect_reply callback = call->callback;
+
+	CONNMAN_PROBE2(reply, "Connect", dbus_g_proxy_get_path(proxy));
+
+	if (callback != NULL)
+		callback(proxy, error, call->user_data);
+	else if (error != NULL)
+		g_error_free(error);
+
+	g_object_unref(proxy);
+	g_free(call);
+}
+
 void connman_client_connect_async(ConnmanClient *client, const gchar *network,
 		connman_connect_reply callback, gpointer userdata)
 {
@@ -446,7 +1483,12 @@ void connman_client_connect_async(ConnmanClient *client, const gchar *network,
 	if (proxy == NULL)
 		goto done;
 
-	connman_connect_async(proxy, callback, userdata);
+	connect_started(priv, network);
+
+	CONNMAN_PROBE2(call, "Connect", network);
+
+	connman_connect_async(proxy, connect_reply,
+				async_call_new(callback, userdata));
 
 done:
 	return;
@@ -476,16 +1518,41 @@ void connman_client_disconnect(ConnmanClient *client, const gchar *network)
 	if (proxy == NULL)
 		return;
 
+	CONNMAN_PROBE2(call, "Disconnect", network);
+
 	connman_disconnect(proxy, NULL);
 
 	g_object_unref(proxy);
 }
 
-gchar *connman_client_get_security(ConnmanClient *client, const gchar *network)
+void connman_client_disconnect_async(ConnmanClient *client,
+				const gchar *network,
+				connman_disconnect_reply callback, gpointer userdata)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	DBusGProxy *proxy;
+
+	DBG("client %p network %s", client, network);
+
+	if (network == NULL)
+		return;
+
+	proxy = connman_dbus_get_proxy(priv->store, network);
+	if (proxy == NULL)
+		return;
+
+	CONNMAN_PROBE2(call, "Disconnect", network);
+
+	connman_disconnect_async(proxy, disconnect_reply,
+				async_call_new(callback, userdata));
+}
+
+const gchar *connman_client_get_security(ConnmanClient *client,
+							const gchar *network)
 {
 	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
 	GtkTreeIter iter;
-	gchar *security;
+	const gchar *security;
 
 	DBG("client %p", client);
 
@@ -501,6 +1568,27 @@ gchar *connman_client_get_security(ConnmanClient *client, const gchar *network)
 	return security;
 }
 
+const gchar *connman_client_get_state(ConnmanClient *client,
+							const gchar *network)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(client);
+	GtkTreeIter iter;
+	const gchar *state;
+
+	DBG("client %p", client);
+
+	if (network == NULL)
+		return NULL;
+
+	if (connman_dbus_get_iter(priv->store, network, &iter) == FALSE)
+		return NULL;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(priv->store), &iter,
+				CONNMAN_COLUMN_STATE, &state, -1);
+
+	return state;
+}
+
 void connman_client_set_callback(ConnmanClient *client,
 			ConnmanClientCallback callback, gpointer user_data)
 {
@@ -532,7 +1620,245 @@ void connman_client_remove(ConnmanClient *client, const gchar *network)
 	if (proxy == NULL)
 		return;
 
+	CONNMAN_PROBE2(call, "Remove", network);
+
 	connman_remove(proxy, NULL);
 
 	g_object_unref(proxy);
 }
+
+/*
+ * A batch queues property writes and method calls and sends them all
+ * back-to-back when connman_client_batch_send() is called, so the
+ * caller waits roughly one round-trip instead of one per operation.
+ */
+struct batch_op {
+	ConnmanClientBatch *batch;
+	guint index;
+	gchar *path;
+	gchar *name;
+	GValue value;
+	gboolean method;
+};
+
+struct _ConnmanClientBatch {
+	ConnmanClient *client;
+	GPtrArray *ops;
+	GError **errors;
+	guint pending;
+	ConnmanClientBatchCallback callback;
+	gpointer user_data;
+};
+
+ConnmanClientBatch *connman_client_batch_new(ConnmanClient *client)
+{
+	ConnmanClientBatch *batch;
+
+	DBG("client %p", client);
+
+	batch = g_new0(ConnmanClientBatch, 1);
+	batch->client = g_object_ref(client);
+	batch->ops = g_ptr_array_new();
+
+	return batch;
+}
+
+static struct batch_op *batch_add(ConnmanClientBatch *batch,
+				const gchar *path, const gchar *name)
+{
+	struct batch_op *op;
+
+	op = g_new0(struct batch_op, 1);
+	op->batch = batch;
+	op->index = batch->ops->len;
+	op->path = g_strdup(path);
+	op->name = g_strdup(name);
+
+	g_ptr_array_add(batch->ops, op);
+
+	return op;
+}
+
+void connman_client_batch_set_property(ConnmanClientBatch *batch,
+		const gchar *path, const gchar *property, const GValue *value)
+{
+	struct batch_op *op;
+
+	DBG("batch %p path %s property %s", batch, path, property);
+
+	op = batch_add(batch, path, property);
+
+	g_value_init(&op->value, G_VALUE_TYPE(value));
+	g_value_copy(value, &op->value);
+}
+
+void connman_client_batch_call(ConnmanClientBatch *batch,
+				const gchar *path, const gchar *method)
+{
+	struct batch_op *op;
+
+	DBG("batch %p path %s method %s", batch, path, method);
+
+	op = batch_add(batch, path, method);
+	op->method = TRUE;
+}
+
+void connman_client_batch_set_powered(ConnmanClientBatch *batch,
+				const gchar *device, gboolean powered)
+{
+	GValue value = { 0 };
+
+	g_value_init(&value, G_TYPE_BOOLEAN);
+	g_value_set_boolean(&value, powered);
+
+	connman_client_batch_set_property(batch, device, "Powered", &value);
+
+	g_value_unset(&value);
+}
+
+void connman_client_batch_set_offlinemode(ConnmanClientBatch *batch,
+							gboolean status)
+{
+	GValue value = { 0 };
+
+	g_value_init(&value, G_TYPE_BOOLEAN);
+	g_value_set_boolean(&value, status);
+
+	connman_client_batch_set_property(batch, CONNMAN_MANAGER_PATH,
+						"OfflineMode", &value);
+
+	g_value_unset(&value);
+}
+
+void connman_client_batch_set_ipv4(ConnmanClientBatch *batch,
+		const gchar *device, struct ipv4_config *ipv4_config)
+{
+	GValue value = { 0 };
+
+	g_value_init(&value, DBUS_TYPE_G_DICTIONARY);
+	g_value_take_boxed(&value, ipv4_config_to_hash(ipv4_config));
+
+	connman_client_batch_set_property(batch, device,
+					"IPv4.Configuration", &value);
+
+	g_value_unset(&value);
+}
+
+static void batch_free(ConnmanClientBatch *batch)
+{
+	struct batch_op *op;
+	guint i;
+
+	for (i = 0; i < batch->ops->len; i++) {
+		op = g_ptr_array_index(batch->ops, i);
+
+		if (batch->errors != NULL && batch->errors[i] != NULL)
+			g_error_free(batch->errors[i]);
+
+		if (G_IS_VALUE(&op->value))
+			g_value_unset(&op->value);
+
+		g_free(op->path);
+		g_free(op->name);
+		g_free(op);
+	}
+
+	g_ptr_array_free(batch->ops, TRUE);
+	g_free(batch->errors);
+
+	g_object_unref(batch->client);
+	g_free(batch);
+}
+
+static void batch_complete(ConnmanClientBatch *batch)
+{
+	DBG("batch %p count %d", batch, batch->ops->len);
+
+	if (batch->callback != NULL)
+		batch->callback(batch->ops->len, batch->errors,
+							batch->user_data);
+
+	batch_free(batch);
+}
+
+static void batch_reply(DBusGProxy *proxy, DBusGProxyCall *call,
+							gpointer user_data)
+{
+	struct batch_op *op = user_data;
+	ConnmanClientBatch *batch = op->batch;
+
+	dbus_g_proxy_end_call(proxy, call, &batch->errors[op->index],
+							G_TYPE_INVALID);
+
+	CONNMAN_PROBE2(reply, op->method == TRUE ? op->name : "SetProperty",
+								op->path);
+
+	g_object_unref(proxy);
+
+	if (--batch->pending == 0)
+		batch_complete(batch);
+}
+
+void connman_client_batch_send(ConnmanClientBatch *batch,
+		ConnmanClientBatchCallback callback, gpointer user_data)
+{
+	ConnmanClientPrivate *priv = CONNMAN_CLIENT_GET_PRIVATE(batch->client);
+	struct batch_op *op;
+	DBusGProxy *proxy;
+	DBusGProxyCall *call;
+	guint i;
+
+	DBG("batch %p count %d", batch, batch->ops->len);
+
+	batch->callback = callback;
+	batch->user_data = user_data;
+	batch->errors = g_new0(GError *, batch->ops->len + 1);
+
+	for (i = 0; i < batch->ops->len; i++) {
+		op = g_ptr_array_index(batch->ops, i);
+
+		if (g_strcmp0(op->path, CONNMAN_MANAGER_PATH) == 0)
+			proxy = g_object_ref(priv->manager);
+		else
+			proxy = connman_dbus_get_proxy(priv->store, op->path);
+
+		if (proxy == NULL) {
+			batch->errors[i] = g_error_new(DBUS_GERROR,
+					DBUS_GERROR_FAILED,
+					"Unknown object %s", op->path);
+			continue;
+		}
+
+		/*
+		 * The replies hold the batch, so count before sending.
+		 * Each reply also drops the proxy reference taken here.
+		 */
+		batch->pending++;
+
+		CONNMAN_PROBE2(call, op->method == TRUE ?
+					op->name : "SetProperty", op->path);
+
+		if (op->method == TRUE)
+			call = dbus_g_proxy_begin_call(proxy, op->name,
+					batch_reply, op, NULL, G_TYPE_INVALID);
+		else
+			call = dbus_g_proxy_begin_call(proxy, "SetProperty",
+					batch_reply, op, NULL,
+					G_TYPE_STRING, op->name,
+					G_TYPE_VALUE, &op->value,
+					G_TYPE_INVALID);
+
+		/* No reply is coming for a call that couldn't be sent */
+		if (call == NULL) {
+			batch->errors[i] = g_error_new(DBUS_GERROR,
+					DBUS_GERROR_FAILED,
+					"Can't send %s to %s", op->method == TRUE ?
+					op->name : "SetProperty", op->path);
+			g_object_unref(proxy);
+			batch->pending--;
+		}
+	}
+
+	if (batch->pending == 0)
+		batch_complete(batch);
+}
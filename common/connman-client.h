@@ -50,6 +50,32 @@ struct _ConnmanClientClass {
 	GObjectClass parent_class;
 };
 
+#define CONNMAN_HISTORY_LENGTH	64
+
+struct connman_sample {
+	gint64 time;		/* microseconds since the epoch */
+	const gchar *state;	/* interned, see below */
+	guint strength;
+};
+
+/*
+ * Phases of a connect attempt, from the connect request to the first
+ * ready/online state. Time spent waiting on agent input is taken out
+ * of the phase it happened in.
+ */
+enum {
+	CONNMAN_PHASE_REQUEST,
+	CONNMAN_PHASE_ASSOCIATION,
+	CONNMAN_PHASE_INPUT,
+	CONNMAN_PHASE_CONFIGURATION,
+	CONNMAN_PHASE_TOTAL,
+
+	_CONNMAN_NUM_PHASES
+};
+
+/* Bucket i counts the attempts that took less than 2^i ms */
+#define CONNMAN_HISTOGRAM_BUCKETS	16
+
 struct ipv4_config {
 	const gchar *method;
 	const gchar *address;
@@ -61,8 +87,51 @@ GType connman_client_get_type(void);
 
 ConnmanClient *connman_client_new(void);
 
+/*
+ * The "populated" signal is emitted once the initial manager state,
+ * technologies and services have all been loaded into the model.
+ */
+gboolean connman_client_is_populated(ConnmanClient *client);
+
+/* Number of property updates that matched the model and were dropped */
+guint connman_client_get_suppressed_writes(ConnmanClient *client);
+
+/*
+ * "service-added" and "service-removed" carry the object path of the
+ * service; "service-changed" also carries a CONNMAN_CHANGED() mask of
+ * the columns that were updated, so that listeners can ignore changes
+ * they don't display without reading the model.
+ */
+
 GtkTreeModel *connman_client_get_model(ConnmanClient *client);
 GtkTreeModel *connman_client_get_device_model(ConnmanClient *client);
+
+/*
+ * Services grouped by name and type. Each top level row stands for one
+ * group and has no proxy; it carries the best strength, the state of
+ * its most connected member and the number of members in the children
+ * column. The members are its child rows. The model is only built and
+ * kept up to date once it has been asked for.
+ */
+GtkTreeModel *connman_client_get_grouped_model(ConnmanClient *client);
+
+/*
+ * Only show the services of a device model whose name contains text,
+ * case insensitively. NULL or an empty text shows all of them again.
+ */
+void connman_client_search(ConnmanClient *client, GtkTreeModel *model,
+							const gchar *text);
+
+/*
+ * Tell the client which rows of model, from start to end inclusive, a
+ * view shows. Strength updates for the other services then reach the
+ * models a few seconds late or when their row becomes visible. The
+ * service-changed signal, connman_client_get_service_info() and the
+ * history see them right away. A NULL range means that all rows are
+ * shown.
+ */
+void connman_client_set_visible_range(ConnmanClient *client,
+		GtkTreeModel *model, GtkTreePath *start, GtkTreePath *end);
 GtkTreeModel *connman_client_get_connection_model(ConnmanClient *client);
 
 void connman_client_set_powered(ConnmanClient *client, const gchar *device,
@@ -74,9 +143,13 @@ void connman_client_scan(ConnmanClient *client, const gchar *device,
 
 void connman_client_connect(ConnmanClient *client, const gchar *network);
 void connman_client_disconnect(ConnmanClient *client, const gchar *network);
-gchar *connman_client_get_security(ConnmanClient *client, const gchar *network);
+const gchar *connman_client_get_security(ConnmanClient *client, const gchar *network);
+const gchar *connman_client_get_state(ConnmanClient *client, const gchar *network);
 void connman_client_connect_async(ConnmanClient *client, const gchar *network,
 				connman_connect_reply callback, gpointer userdata);
+void connman_client_disconnect_async(ConnmanClient *client,
+				const gchar *network,
+				connman_disconnect_reply callback, gpointer userdata);
 void connman_client_set_remember(ConnmanClient *client, const gchar *network,
 							gboolean remember);
 
@@ -87,6 +160,70 @@ void connman_client_set_callback(ConnmanClient *client,
 
 void connman_client_remove(ConnmanClient *client, const gchar *network);
 
+/*
+ * Copy the most recent Strength/State samples of a service, oldest
+ * first, and return how many were copied (at most length).
+ */
+guint connman_client_get_history(ConnmanClient *client, const gchar *network,
+			struct connman_sample *samples, guint length);
+
+struct connman_service_info {
+	gchar *name;
+	gchar *address;
+	guint type;
+	const gchar *state;	/* interned */
+	const gchar *security;	/* interned */
+	guint strength;
+	gint64 connected;	/* microseconds since the epoch, 0 if not */
+};
+
+/*
+ * Fill in what the model knows about a service. The connect time is
+ * when the client first saw it ready or online, so for a service that
+ * was already up at startup it is the time the client started. Free
+ * name and address with g_free().
+ */
+gboolean connman_client_get_service_info(ConnmanClient *client,
+		const gchar *network, struct connman_service_info *info);
+
+/*
+ * Copy the per-phase durations in microseconds of the last completed
+ * connect attempt of a service into phases[_CONNMAN_NUM_PHASES].
+ */
+gboolean connman_client_get_last_connect(ConnmanClient *client,
+				const gchar *network, gint64 *phases);
+/*
+ * Copy the rolling histogram of a phase for a service type (one of
+ * the CONNMAN_TYPE_* service types) into buckets[CONNMAN_HISTOGRAM_BUCKETS].
+ */
+gboolean connman_client_get_histogram(ConnmanClient *client, guint type,
+					guint phase, guint *buckets);
+void connman_client_set_input_pending(ConnmanClient *client,
+				const gchar *network, gboolean pending);
+
+typedef struct _ConnmanClientBatch ConnmanClientBatch;
+
+/*
+ * errors[i] is NULL when operation i of the batch succeeded. The batch
+ * and its errors are freed once the callback returns.
+ */
+typedef void (* ConnmanClientBatchCallback) (guint count, GError **errors,
+							gpointer user_data);
+
+ConnmanClientBatch *connman_client_batch_new(ConnmanClient *client);
+void connman_client_batch_set_property(ConnmanClientBatch *batch,
+		const gchar *path, const gchar *property, const GValue *value);
+void connman_client_batch_call(ConnmanClientBatch *batch,
+				const gchar *path, const gchar *method);
+void connman_client_batch_set_powered(ConnmanClientBatch *batch,
+				const gchar *device, gboolean powered);
+void connman_client_batch_set_offlinemode(ConnmanClientBatch *batch,
+							gboolean status);
+void connman_client_batch_set_ipv4(ConnmanClientBatch *batch,
+		const gchar *device, struct ipv4_config *ipv4_config);
+void connman_client_batch_send(ConnmanClientBatch *batch,
+		ConnmanClientBatchCallback callback, gpointer user_data);
+
 gboolean connman_client_get_offline_status(ConnmanClient *client);
 void connman_client_set_offlinemode(ConnmanClient *client, gboolean status);
 
@@ -95,26 +232,35 @@ void connman_client_enable_technology(ConnmanClient *client, const char *network
 void connman_client_disable_technology(ConnmanClient *client, const char *network,
 				      const gchar *technology);
 
+/*
+ * The object path, icon, state, security and IPv4 method columns hold
+ * interned strings (see g_intern_string) and must not be freed by the
+ * caller. Use connman_client functions to call methods on a path.
+ */
 enum {
-	CONNMAN_COLUMN_PROXY,		/* G_TYPE_OBJECT  */
+	CONNMAN_COLUMN_PATH,		/* G_TYPE_POINTER */
 	CONNMAN_COLUMN_INDEX,		/* G_TYPE_UINT    */
 	CONNMAN_COLUMN_NAME,		/* G_TYPE_STRING  */
-	CONNMAN_COLUMN_ICON,		/* G_TYPE_STRING  */
+	CONNMAN_COLUMN_ICON,		/* G_TYPE_POINTER */
 	CONNMAN_COLUMN_TYPE,		/* G_TYPE_UINT    */
-	CONNMAN_COLUMN_STATE,		/* G_TYPE_STRING  */
+	CONNMAN_COLUMN_STATE,		/* G_TYPE_POINTER */
 	CONNMAN_COLUMN_FAVORITE,	/* G_TYPE_BOOLEAN */
 	CONNMAN_COLUMN_STRENGTH,	/* G_TYPE_UINT    */
-	CONNMAN_COLUMN_SECURITY,	/* G_TYPE_STRING  */
-	CONNMAN_COLUMN_METHOD,		/* G_TYPE_STRING  */
+	CONNMAN_COLUMN_SECURITY,	/* G_TYPE_POINTER */
+	CONNMAN_COLUMN_METHOD,		/* G_TYPE_POINTER */
 	CONNMAN_COLUMN_ADDRESS,		/* G_TYPE_STRING  */
 	CONNMAN_COLUMN_NETMASK,		/* G_TYPE_STRING  */
 	CONNMAN_COLUMN_GATEWAY,		/* G_TYPE_STRING  */
 	CONNMAN_COLUMN_POWERED,		/* G_TYPE_BOOLEAN  */
 	CONNMAN_COLUMN_OFFLINEMODE,	/* G_TYPE_BOOLEAN  */
+	CONNMAN_COLUMN_CHILDREN,	/* G_TYPE_UINT    */
 
 	_CONNMAN_NUM_COLUMNS
 };
 
+/* Bit for a column in the mask carried by "service-changed" */
+#define CONNMAN_CHANGED(column)	(1 << (column))
+
 enum {
 	CONNMAN_TYPE_UNKNOWN,
 	CONNMAN_TYPE_ETHERNET,
@@ -131,6 +277,9 @@ enum {
 	_CONNMAN_NUM_TYPE,
 };
 
+/* Service rows, as opposed to technology labels and the system row */
+#define CONNMAN_TYPE_IS_SERVICE(type)	((type) < CONNMAN_TYPE_LABEL_ETHERNET)
+
 enum {
 	CONNMAN_POLICY_DHCP,
 	CONNMAN_POLICY_MANUAL,
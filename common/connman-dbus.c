@@ -23,10 +23,15 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "connman-client.h"
 
 #include "connman-dbus.h"
 #include "connman-dbus-glue.h"
+#include "connman-trace.h"
+#include "connman-profile.h"
+#include "connman-probe.h"
 
 #include "marshal.h"
 
@@ -36,17 +41,217 @@
 #define DBG(fmt...)
 #endif
 
-#ifndef DBUS_TYPE_G_OBJECT_PATH_ARRAY
-#define DBUS_TYPE_G_OBJECT_PATH_ARRAY \
-	(dbus_g_type_get_collection("GPtrArray", DBUS_TYPE_G_OBJECT_PATH))
-#endif
+static DBusGConnection *connection = NULL;
 
-#ifndef DBUS_TYPE_G_DICTIONARY
-#define DBUS_TYPE_G_DICTIONARY \
-	(dbus_g_type_get_map("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
-#endif
+/*
+ * Rows only hold the interned object path. Proxies are made when a
+ * method is called and the most recently used ones are kept around.
+ * Dropping one from the pool only releases the pool's reference, so
+ * callers keep theirs until any pending reply has arrived.
+ */
+#define PROXY_POOL_SIZE	8
 
-static DBusGConnection *connection = NULL;
+static GQueue *proxy_pool = NULL;
+
+/* PropertyChanged of every service and technology, see signal_filter() */
+#define SERVICE_MATCH	"type='signal',sender='" CONNMAN_SERVICE "'," \
+			"interface='" CONNMAN_SERVICE_INTERFACE "'," \
+			"member='PropertyChanged'"
+#define TECHNOLOGY_MATCH "type='signal',sender='" CONNMAN_SERVICE "'," \
+			"interface='" CONNMAN_TECHNOLOGY_INTERFACE "'," \
+			"member='PropertyChanged'"
+
+/* Who owns net.connman, the only sender signal_filter() listens to */
+#define OWNER_MATCH	"type='signal',sender='" DBUS_SERVICE_DBUS "'," \
+			"interface='" DBUS_INTERFACE_DBUS "'," \
+			"member='NameOwnerChanged',arg0='" CONNMAN_SERVICE "'"
+
+/*
+ * The replies to the three initial manager calls are held back until
+ * all of them have arrived and are then published in one pass, so the
+ * store is built without searching it for every row and a view is only
+ * attached once there is something to show.
+ *
+ * When the daemon comes back after a restart the same three calls are
+ * made again and their result is diffed against the rows already in
+ * the store, so rows of services that survived are left in place.
+ */
+enum {
+	MANAGER_PROPERTIES	= 1 << 0,
+	MANAGER_TECHNOLOGIES	= 1 << 1,
+	MANAGER_SERVICES	= 1 << 2,
+};
+
+/*
+ * A service PropertyChanged signal is decoded right away into a diff
+ * that only holds the fields it carries. Diffs for the same service are
+ * merged until they are written, so a burst of Strength updates ends up
+ * as a single store write. The services added and removed by a
+ * ServicesChanged signal go through the same queue: a removal drops
+ * whatever was queued before it and a new set of properties replaces
+ * the older fields. The queue is drained from an idle handler, which
+ * runs after input and redraws, and each run stops once its time budget
+ * is spent.
+ */
+#define DIFF_BUDGET	4	/* milliseconds per main loop iteration */
+
+/*
+ * Once a view has said which services it shows, strength updates for
+ * the others are parked in a shadow table instead of the store, which
+ * spares the view a redraw per update. They are folded in when the row
+ * scrolls into view or, at the latest, every SHADOW_INTERVAL seconds.
+ * Only the store lags behind: SERVICE_CHANGED is notified when a value
+ * is parked and connman_dbus_get_strength() reads through the shadow.
+ * Everything else is written right away since state and addresses are
+ * acted upon, not only displayed.
+ */
+#define DIFF_DEFERRABLE	CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH)
+#define SHADOW_INTERVAL	5	/* seconds */
+
+struct service_diff {
+	gchar *path;
+	gboolean removed;	/* the row goes away before anything else */
+	GHashTable *properties;	/* all of them, from ServicesChanged */
+	guint fields;		/* CONNMAN_CHANGED() bits carried */
+	const gchar *state;
+	gboolean favorite;
+	const gchar *security;
+	guint strength;
+	const gchar *method;
+	gchar *addr;
+	gchar *netmask;
+	gchar *gateway;
+};
+
+static void diff_clear_properties(struct service_diff *diff)
+{
+	if (diff->properties == NULL)
+		return;
+
+	g_boxed_free(DBUS_TYPE_G_DICTIONARY, diff->properties);
+	diff->properties = NULL;
+}
+
+static void diff_free(gpointer user_data)
+{
+	struct service_diff *diff = user_data;
+
+	diff_clear_properties(diff);
+
+	g_free(diff->path);
+	g_free(diff->addr);
+	g_free(diff->netmask);
+	g_free(diff->gateway);
+	g_free(diff);
+}
+
+/* FALSE once everything the diff carried was dropped */
+static gboolean diff_pending(struct service_diff *diff)
+{
+	return diff->removed == TRUE || diff->properties != NULL ||
+							diff->fields != 0;
+}
+
+struct manager_data {
+	guint generation;	/* of the query round, see manager_query() */
+	guint pending;
+	gboolean loaded;
+	guint suppressed;
+	GHashTable *properties;
+	GPtrArray *technologies;
+	GPtrArray *services;
+	ConnmanDBusNotifyFunc notify;
+	gpointer user_data;
+	GHashTable *diffs;	/* path -> queued service_diff */
+	GQueue *diff_queue;
+	GTimer *diff_timer;
+	guint diff_id;
+	GHashTable *visible;	/* paths shown by the view, NULL for all */
+	GHashTable *shadow;	/* path -> deferred service_diff */
+	guint shadow_id;
+	gchar *owner;		/* unique name of net.connman, if any */
+	DBusPendingCall *owner_call;
+};
+
+/* Drop the replies held back for a query round that won't complete */
+static void manager_data_unstage(struct manager_data *data)
+{
+	if (data->properties != NULL) {
+		g_hash_table_destroy(data->properties);
+		data->properties = NULL;
+	}
+
+	if (data->technologies != NULL) {
+		g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+							data->technologies);
+		data->technologies = NULL;
+	}
+
+	if (data->services != NULL) {
+		g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+							data->services);
+		data->services = NULL;
+	}
+}
+
+static void manager_data_free(gpointer user_data)
+{
+	struct manager_data *data = user_data;
+	struct service_diff *diff;
+
+	if (data->diff_id > 0)
+		g_source_remove(data->diff_id);
+
+	if (data->shadow_id > 0)
+		g_source_remove(data->shadow_id);
+
+	if (data->owner_call != NULL) {
+		dbus_pending_call_cancel(data->owner_call);
+		dbus_pending_call_unref(data->owner_call);
+	}
+
+	g_free(data->owner);
+
+	while ((diff = g_queue_pop_head(data->diff_queue)) != NULL)
+		diff_free(diff);
+
+	g_queue_free(data->diff_queue);
+	g_hash_table_destroy(data->diffs);
+	g_timer_destroy(data->diff_timer);
+	g_hash_table_destroy(data->shadow);
+
+	if (data->visible != NULL)
+		g_hash_table_destroy(data->visible);
+
+	manager_data_unstage(data);
+
+	g_free(data);
+}
+
+static struct manager_data *get_manager_data(GtkTreeStore *store)
+{
+	return g_object_get_data(G_OBJECT(store), "manager");
+}
+
+/* Counts a write that was skipped because the row already matched */
+static void suppressed_write(GtkTreeStore *store)
+{
+	struct manager_data *data = get_manager_data(store);
+
+	if (data != NULL)
+		data->suppressed++;
+}
+
+static void notify_event(GtkTreeStore *store, guint event, const char *path,
+							guint changed)
+{
+	struct manager_data *data = get_manager_data(store);
+
+	if (data == NULL || data->notify == NULL)
+		return;
+
+	data->notify(event, path, changed, data->user_data);
+}
 
 typedef gboolean (*IterSearchFunc) (GtkTreeStore *store,
 				GtkTreeIter *iter, gconstpointer user_data);
@@ -83,60 +288,33 @@ static gboolean iter_search(GtkTreeStore *store,
 	return found;
 }
 
-static gboolean compare_proxy(GtkTreeStore *store, GtkTreeIter *iter,
+static gboolean compare_path(GtkTreeStore *store, GtkTreeIter *iter,
 						gconstpointer user_data)
-{
-	const char *path = user_data;
-	DBusGProxy *proxy;
-	gboolean found = FALSE;
-
-	gtk_tree_model_get(GTK_TREE_MODEL(store), iter,
-					CONNMAN_COLUMN_PROXY, &proxy, -1);
-
-	if (proxy != NULL) {
-		found = g_str_equal(path, dbus_g_proxy_get_path(proxy));
-		g_object_unref(proxy);
-	}
-
-	return found;
-}
-
-static gboolean get_iter_from_proxy(GtkTreeStore *store,
-					GtkTreeIter *iter, DBusGProxy *proxy)
 {
 	const char *path;
 
-	if (proxy == NULL)
-		return FALSE;
-
-	path = dbus_g_proxy_get_path(proxy);
-	if (path == NULL)
-		return FALSE;
+	gtk_tree_model_get(GTK_TREE_MODEL(store), iter,
+					CONNMAN_COLUMN_PATH, &path, -1);
 
-	return iter_search(store, iter, NULL, compare_proxy, path);
+	/* Both sides are interned, so comparing pointers is enough */
+	return path != NULL && path == user_data;
 }
 
 static gboolean get_iter_from_path(GtkTreeStore *store,
 					GtkTreeIter *iter, const char *path)
 {
+	GQuark quark;
+
 	if (path == NULL)
 		return FALSE;
 
-	return iter_search(store, iter, NULL, compare_proxy, path);
-}
-
-DBusGProxy *connman_dbus_get_proxy(GtkTreeStore *store, const gchar *path)
-{
-	DBusGProxy *proxy;
-	GtkTreeIter iter;
-
-	if (iter_search(store, &iter, NULL, compare_proxy, path) == FALSE)
-		return NULL;
-
-	gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
-					CONNMAN_COLUMN_PROXY, &proxy, -1);
+	/* A path that was never interned can't be in the store */
+	quark = g_quark_try_string(path);
+	if (quark == 0)
+		return FALSE;
 
-	return proxy;
+	return iter_search(store, iter, NULL, compare_path,
+						g_quark_to_string(quark));
 }
 
 static gboolean compare_type(GtkTreeStore *store, GtkTreeIter *iter,
@@ -166,6 +344,49 @@ gboolean connman_dbus_get_iter(GtkTreeStore *store, const gchar *path,
 	return get_iter_from_path(store, iter, path);
 }
 
+gboolean connman_dbus_get_strength(GtkTreeStore *store, const gchar *path,
+							guint *strength)
+{
+	struct manager_data *data = get_manager_data(store);
+	struct service_diff *shadow = NULL;
+	GtkTreeIter iter;
+
+	if (get_iter_from_path(store, &iter, path) == FALSE)
+		return FALSE;
+
+	if (data != NULL)
+		shadow = g_hash_table_lookup(data->shadow, path);
+
+	if (shadow != NULL)
+		*strength = shadow->strength;
+	else
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
+				CONNMAN_COLUMN_STRENGTH, strength, -1);
+
+	return TRUE;
+}
+
+GtkTreeStore *connman_dbus_store_new(void)
+{
+	return gtk_tree_store_new(_CONNMAN_NUM_COLUMNS,
+				G_TYPE_POINTER,	/* path */
+				G_TYPE_UINT,	/* index */
+				G_TYPE_STRING,	/* name */
+				G_TYPE_POINTER,	/* icon */
+				G_TYPE_UINT,	/* type */
+				G_TYPE_POINTER,	/* state */
+				G_TYPE_BOOLEAN,	/* favorite */
+				G_TYPE_UINT,	/* strength */
+				G_TYPE_POINTER,	/* security */
+				G_TYPE_POINTER, /* method */
+				G_TYPE_STRING,  /* address */
+				G_TYPE_STRING,  /* netmask */
+				G_TYPE_STRING,  /* gateway */
+				G_TYPE_BOOLEAN, /* powered */
+				G_TYPE_BOOLEAN, /* offline */
+				G_TYPE_UINT);	/* children */
+}
+
 static guint get_type(const GValue *value)
 {
 	const char *type = value ? g_value_get_string(value) : NULL;
@@ -203,14 +424,35 @@ static const gchar *type2icon(guint type)
 	return NULL;
 }
 
-static void tech_changed(DBusGProxy *proxy, const char *property,
-					GValue *value, gpointer user_data)
+static const gchar *get_security(const GValue *value)
+{
+	gchar **array = value ? g_value_get_boxed(value) : NULL;
+	const gchar *security;
+	gchar *str;
+
+	if (array == NULL)
+		return NULL;
+
+	str = g_strjoinv(" ", array);
+	security = g_intern_string(str);
+	g_free(str);
+
+	return security;
+}
+
+static const gchar *get_string(GHashTable *hash, const char *key)
+{
+	GValue *value = g_hash_table_lookup(hash, key);
+
+	return value ? g_value_get_string(value) : NULL;
+}
+
+static void tech_update(GtkTreeStore *store, const char *path,
+					const char *property, GValue *value)
 {
-	GtkTreeStore *store = user_data;
-	const char *path = dbus_g_proxy_get_path(proxy);
 	GtkTreeIter iter;
 
-	DBG("store %p proxy %p property %s", store, proxy, property);
+	DBG("store %p path %s property %s", store, path, property);
 
 	if (property == NULL || value == NULL)
 		return;
@@ -220,15 +462,23 @@ static void tech_changed(DBusGProxy *proxy, const char *property,
 
 	if (g_str_equal(property, "Powered") == TRUE) {
 		gboolean powered = g_value_get_boolean(value);
+		gboolean old;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
+					CONNMAN_COLUMN_POWERED, &old, -1);
+		if (old == powered) {
+			suppressed_write(store);
+			return;
+		}
+
 		gtk_tree_store_set(store, &iter,
 					CONNMAN_COLUMN_POWERED, powered, -1);
 	}
 }
 
-static void tech_properties(DBusGProxy *proxy, GHashTable *hash,
-					GError *error, gpointer user_data)
+static void tech_properties(GtkTreeStore *store, const char *path,
+							GHashTable *hash)
 {
-	GtkTreeStore *store = user_data;
 	GtkTreeIter iter;
 	gboolean powered = FALSE;
 	GValue *propval = 0;
@@ -246,7 +496,7 @@ static void tech_properties(DBusGProxy *proxy, GHashTable *hash,
 			gtk_tree_store_append(store, &iter, NULL);
 
 		gtk_tree_store_set(store, &iter,
-				CONNMAN_COLUMN_PROXY, proxy,
+				CONNMAN_COLUMN_PATH, g_intern_string(path),
 				CONNMAN_COLUMN_POWERED, powered,
 				CONNMAN_COLUMN_TYPE, CONNMAN_TYPE_LABEL_ETHERNET,
 				-1);
@@ -257,7 +507,7 @@ static void tech_properties(DBusGProxy *proxy, GHashTable *hash,
 			gtk_tree_store_append(store, &iter, NULL);
 
 		gtk_tree_store_set(store, &iter,
-				CONNMAN_COLUMN_PROXY, proxy,
+				CONNMAN_COLUMN_PATH, g_intern_string(path),
 				CONNMAN_COLUMN_POWERED, powered,
 				CONNMAN_COLUMN_TYPE, CONNMAN_TYPE_LABEL_WIFI,
 				-1);
@@ -268,7 +518,7 @@ static void tech_properties(DBusGProxy *proxy, GHashTable *hash,
 			gtk_tree_store_append(store, &iter, NULL);
 
 		gtk_tree_store_set(store, &iter,
-				CONNMAN_COLUMN_PROXY, proxy,
+				CONNMAN_COLUMN_PATH, g_intern_string(path),
 				CONNMAN_COLUMN_POWERED, powered,
 				CONNMAN_COLUMN_TYPE, CONNMAN_TYPE_LABEL_CELLULAR,
 				-1);
@@ -279,8 +529,18 @@ static void offline_mode_changed(GtkTreeStore *store, GValue *value)
 {
 	GtkTreeIter iter;
 	gboolean offline_mode = g_value_get_boolean(value);
+	gboolean old;
+
+	if (get_iter_from_type(store, &iter, CONNMAN_TYPE_SYSCONFIG) == FALSE)
+		return;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
+				CONNMAN_COLUMN_OFFLINEMODE, &old, -1);
+	if (old == offline_mode) {
+		suppressed_write(store);
+		return;
+	}
 
-	get_iter_from_type(store, &iter, CONNMAN_TYPE_SYSCONFIG);
 	gtk_tree_store_set(store, &iter,
 			CONNMAN_COLUMN_OFFLINEMODE, offline_mode,
 			-1);
@@ -293,20 +553,15 @@ static void tech_added(DBusGProxy *proxy, DBusGObjectPath *path,
 	GtkTreeIter iter;
 	DBG("store %p proxy %p hash %p", store, proxy, hash);
 
-	if (!get_iter_from_path(store, &iter, path)) {
-		DBusGProxy *tech_proxy = dbus_g_proxy_new_for_name(connection,
-						CONNMAN_SERVICE, path,
-						CONNMAN_TECHNOLOGY_INTERFACE);
-		if (tech_proxy == NULL)
-			return;
+	CONNMAN_PROBE2(signal_entry, "TechnologyAdded", path);
 
-		tech_properties(tech_proxy, hash, NULL, user_data);
+	if (!get_iter_from_path(store, &iter, path))
+		tech_properties(store, path, hash);
+	else
+		tech_update(store, path, "Powered",
+				g_hash_table_lookup(hash, "Powered"));
 
-		dbus_g_proxy_add_signal(tech_proxy, "PropertyChanged",
-				G_TYPE_STRING, G_TYPE_VALUE, G_TYPE_INVALID);
-		dbus_g_proxy_connect_signal(tech_proxy, "PropertyChanged",
-				G_CALLBACK(tech_changed), store, NULL);
-	}
+	CONNMAN_PROBE2(signal_return, "TechnologyAdded", path);
 }
 
 static void tech_removed(DBusGProxy *proxy, DBusGObjectPath *path,
@@ -315,308 +570,1649 @@ static void tech_removed(DBusGProxy *proxy, DBusGObjectPath *path,
 	GtkTreeStore *store = user_data;
 	GtkTreeIter iter;
 
+	CONNMAN_PROBE2(signal_entry, "TechnologyRemoved", path);
+
 	if (get_iter_from_path(store, &iter, path))
 		gtk_tree_store_remove(store, &iter);
+
+	CONNMAN_PROBE2(signal_return, "TechnologyRemoved", path);
 }
 
-static void offline_mode_properties(GtkTreeStore *store, DBusGProxy *proxy, GValue *value)
+static void offline_mode_properties(GtkTreeStore *store, GValue *value)
 {
 	GtkTreeIter iter;
 	gboolean offline_mode = g_value_get_boolean(value);
 
-	if (get_iter_from_type(store, &iter, CONNMAN_TYPE_SYSCONFIG) == FALSE)
-		gtk_tree_store_insert(store, &iter, NULL, 0);
+	/* On a resync the row is already there */
+	if (get_iter_from_type(store, &iter, CONNMAN_TYPE_SYSCONFIG) == TRUE) {
+		offline_mode_changed(store, value);
+		return;
+	}
 
-	gtk_tree_store_set(store, &iter,
-			CONNMAN_COLUMN_PROXY, proxy,
+	gtk_tree_store_insert_with_values(store, &iter, NULL, 0,
+			CONNMAN_COLUMN_PATH,
+				g_intern_string(CONNMAN_MANAGER_PATH),
 			CONNMAN_COLUMN_TYPE, CONNMAN_TYPE_SYSCONFIG,
 			CONNMAN_COLUMN_OFFLINEMODE, offline_mode,
 			-1);
 }
 
-static void service_changed(DBusGProxy *proxy, const char *property,
-					GValue *value, gpointer user_data)
+struct service_data {
+	const gchar *name;
+	const gchar *icon;
+	guint type;
+	const gchar *state;
+	gboolean favorite;
+	const gchar *security;
+	guint strength;
+	const gchar *method;
+	const gchar *addr;
+	const gchar *netmask;
+	const gchar *gateway;
+};
+
+static void service_set(GtkTreeStore *store, GtkTreeIter *iter,
+					struct service_data *service)
 {
-	GtkTreeStore *store = user_data;
-	const char *path = dbus_g_proxy_get_path(proxy);
-	GtkTreeIter iter;
-	GHashTable *ipv4;
-	const char *method, *addr, *netmask, *gateway;
-	GValue *ipv4_method, *ipv4_address, *ipv4_netmask, *ipv4_gateway;
+	gtk_tree_store_set(store, iter,
+				CONNMAN_COLUMN_NAME, service->name,
+				CONNMAN_COLUMN_ICON, service->icon,
+				CONNMAN_COLUMN_TYPE, service->type,
+				CONNMAN_COLUMN_STATE, service->state,
+				CONNMAN_COLUMN_FAVORITE, service->favorite,
+				CONNMAN_COLUMN_SECURITY, service->security,
+				CONNMAN_COLUMN_STRENGTH, service->strength,
+				CONNMAN_COLUMN_METHOD, service->method,
+				CONNMAN_COLUMN_ADDRESS, service->addr,
+				CONNMAN_COLUMN_NETMASK, service->netmask,
+				CONNMAN_COLUMN_GATEWAY, service->gateway,
+				-1);
+}
 
-	DBG("store %p proxy %p property %s", store, proxy, property);
+/*
+ * Reads a row back into a service_data. The name and the IPv4 address
+ * strings are copies and have to be released with service_clear().
+ */
+static void service_get(GtkTreeStore *store, GtkTreeIter *iter,
+					struct service_data *service)
+{
+	gchar *name, *addr, *netmask, *gateway;
 
-	if (property == NULL || value == NULL)
-		return;
+	gtk_tree_model_get(GTK_TREE_MODEL(store), iter,
+				CONNMAN_COLUMN_NAME, &name,
+				CONNMAN_COLUMN_ICON, &service->icon,
+				CONNMAN_COLUMN_TYPE, &service->type,
+				CONNMAN_COLUMN_STATE, &service->state,
+				CONNMAN_COLUMN_FAVORITE, &service->favorite,
+				CONNMAN_COLUMN_SECURITY, &service->security,
+				CONNMAN_COLUMN_STRENGTH, &service->strength,
+				CONNMAN_COLUMN_METHOD, &service->method,
+				CONNMAN_COLUMN_ADDRESS, &addr,
+				CONNMAN_COLUMN_NETMASK, &netmask,
+				CONNMAN_COLUMN_GATEWAY, &gateway,
+				-1);
 
-	if (get_iter_from_path(store, &iter, path) == FALSE)
-		return;
+	service->name = name;
+	service->addr = addr;
+	service->netmask = netmask;
+	service->gateway = gateway;
+}
 
-	if (g_str_equal(property, "IPv4") == TRUE) {
-		ipv4 = g_value_get_boxed (value);
-		if (!ipv4)
-			return;
+static void service_clear(struct service_data *service)
+{
+	g_free((gchar *) service->name);
+	g_free((gchar *) service->addr);
+	g_free((gchar *) service->netmask);
+	g_free((gchar *) service->gateway);
+}
+
+static guint service_compare(struct service_data *a, struct service_data *b)
+{
+	guint changed = 0;
+
+	/* The interned columns can be compared by pointer */
+	if (g_strcmp0(a->name, b->name) != 0)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_NAME);
+	if (a->icon != b->icon)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_ICON);
+	if (a->type != b->type)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_TYPE);
+	if (a->state != b->state)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_STATE);
+	if (a->favorite != b->favorite)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_FAVORITE);
+	if (a->security != b->security)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_SECURITY);
+	if (a->strength != b->strength)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH);
+	if (a->method != b->method)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_METHOD);
+	if (g_strcmp0(a->addr, b->addr) != 0)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_ADDRESS);
+	if (g_strcmp0(a->netmask, b->netmask) != 0)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_NETMASK);
+	if (g_strcmp0(a->gateway, b->gateway) != 0)
+		changed |= CONNMAN_CHANGED(CONNMAN_COLUMN_GATEWAY);
+
+	return changed;
+}
+
+/*
+ * Writes the service into an existing row, but only if some column
+ * actually differs, and returns the mask of the columns that did.
+ * connmand re-sends unchanged properties often, and every write makes
+ * the store emit row-changed and the views repaint.
+ */
+static guint service_store(GtkTreeStore *store, GtkTreeIter *iter,
+					struct service_data *service)
+{
+	struct service_data old;
+	guint changed;
 
-		ipv4_method = g_hash_table_lookup (ipv4, "Method");
-		method = ipv4_method ? g_value_get_string(ipv4_method) : NULL;
+	service_get(store, iter, &old);
+	changed = service_compare(&old, service);
+	service_clear(&old);
 
-		ipv4_address = g_hash_table_lookup (ipv4, "Address");
-		addr = ipv4_address ? g_value_get_string(ipv4_address) : NULL;
+	if (changed == 0) {
+		suppressed_write(store);
+		return 0;
+	}
 
-		ipv4_netmask = g_hash_table_lookup (ipv4, "Netmask");
-		netmask = ipv4_netmask ? g_value_get_string(ipv4_netmask) : NULL;
+	service_set(store, iter, service);
 
-		ipv4_gateway = g_hash_table_lookup (ipv4, "Gateway");
-		gateway = ipv4_gateway ? g_value_get_string(ipv4_gateway) : NULL;
+	return changed;
+}
 
-		gtk_tree_store_set(store, &iter,
-					CONNMAN_COLUMN_METHOD, method,
-					CONNMAN_COLUMN_ADDRESS, addr,
-					CONNMAN_COLUMN_NETMASK, netmask,
-					CONNMAN_COLUMN_GATEWAY, gateway,
-					-1);
+/* Returns FALSE for the properties the store has no column for */
+static gboolean diff_decode(struct service_diff *diff, const char *property,
+							GValue *value)
+{
+	GHashTable *ipv4;
+
+	if (g_str_equal(property, "IPv4") == TRUE) {
+		ipv4 = g_value_get_boxed (value);
+		if (!ipv4)
+			return FALSE;
+
+		g_free(diff->addr);
+		g_free(diff->netmask);
+		g_free(diff->gateway);
+
+		diff->method = g_intern_string(get_string(ipv4, "Method"));
+		diff->addr = g_strdup(get_string(ipv4, "Address"));
+		diff->netmask = g_strdup(get_string(ipv4, "Netmask"));
+		diff->gateway = g_strdup(get_string(ipv4, "Gateway"));
+		diff->fields |= CONNMAN_CHANGED(CONNMAN_COLUMN_METHOD);
 	} else if (g_str_equal(property, "State") == TRUE) {
-		const char *state = value ? g_value_get_string(value) : NULL;
-		gtk_tree_store_set(store, &iter,
-					CONNMAN_COLUMN_STATE, state, -1);
+		diff->state = g_intern_string(g_value_get_string(value));
+		diff->fields |= CONNMAN_CHANGED(CONNMAN_COLUMN_STATE);
 	} else if (g_str_equal(property, "Favorite") == TRUE) {
-		gboolean favorite = g_value_get_boolean(value);
-		gtk_tree_store_set(store, &iter,
-					CONNMAN_COLUMN_FAVORITE, favorite, -1);
+		diff->favorite = g_value_get_boolean(value);
+		diff->fields |= CONNMAN_CHANGED(CONNMAN_COLUMN_FAVORITE);
 	} else if (g_str_equal(property, "Security") == TRUE) {
-		char **array = value ? g_value_get_boxed(value) : NULL;
-		const char *security = g_strjoinv(" ", array);
-		gtk_tree_store_set(store, &iter,
-					CONNMAN_COLUMN_SECURITY, security,
-					-1);
+		diff->security = get_security(value);
+		diff->fields |= CONNMAN_CHANGED(CONNMAN_COLUMN_SECURITY);
 	} else if (g_str_equal(property, "Strength") == TRUE) {
-		guint strength = g_value_get_uchar(value);
-		gtk_tree_store_set(store, &iter,
-					CONNMAN_COLUMN_STRENGTH, strength, -1);
-	}
+		diff->strength = g_value_get_uchar(value);
+		diff->fields |= CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH);
+	} else
+		return FALSE;
+
+	return TRUE;
 }
 
-static void service_properties(DBusGProxy *proxy, GHashTable *hash,
-							gpointer user_data)
+static void diff_apply(GtkTreeStore *store, struct service_diff *diff)
 {
-	GtkTreeStore *store = user_data;
-	GValue *value;
-	const gchar *name, *icon, *security, *state;
-	guint type, strength;
-	gboolean favorite;
+	struct service_data service, old;
 	GtkTreeIter iter;
+	guint changed;
 
-	GHashTable *ipv4;
-	GValue *ipv4_method, *ipv4_address, *ipv4_netmask, *ipv4_gateway;
-	const char *method, *addr, *netmask, *gateway;
+	if (get_iter_from_path(store, &iter, diff->path) == FALSE)
+		return;
 
-	DBG("store %p proxy %p hash %p", store, proxy, hash);
+	service_get(store, &iter, &old);
+	service = old;
 
-	if (hash == NULL)
+	if (diff->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_METHOD)) {
+		service.method = diff->method;
+		service.addr = diff->addr;
+		service.netmask = diff->netmask;
+		service.gateway = diff->gateway;
+	}
+	if (diff->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_STATE))
+		service.state = diff->state;
+	if (diff->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_FAVORITE))
+		service.favorite = diff->favorite;
+	if (diff->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_SECURITY))
+		service.security = diff->security;
+	if (diff->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH))
+		service.strength = diff->strength;
+
+	changed = service_compare(&old, &service);
+	if (changed & CONNMAN_CHANGED(CONNMAN_COLUMN_STATE))
+		CONNMAN_PROBE2(state, diff->path, service.state);
+	if (changed == 0) {
+		suppressed_write(store);
 		goto done;
+	}
 
-	value = g_hash_table_lookup(hash, "Name");
-	name = value ? g_value_get_string(value) : NULL;
+	service_set(store, &iter, &service);
 
-	value = g_hash_table_lookup(hash, "Type");
-	type = get_type(value);
-	icon = type2icon(type);
+	notify_event(store, CONNMAN_DBUS_SERVICE_CHANGED, diff->path, changed);
 
-	value = g_hash_table_lookup(hash, "State");
-	state = value ? g_value_get_string(value) : NULL;
+done:
+	service_clear(&old);
+}
 
-	value = g_hash_table_lookup(hash, "Favorite");
-	favorite = value ? g_value_get_boolean(value) : FALSE;
+/* Move the fields carried by update into diff, update keeps none */
+static void diff_merge(struct service_diff *diff, struct service_diff *update)
+{
+	if (update->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_METHOD)) {
+		g_free(diff->addr);
+		g_free(diff->netmask);
+		g_free(diff->gateway);
+
+		diff->method = update->method;
+		diff->addr = update->addr;
+		diff->netmask = update->netmask;
+		diff->gateway = update->gateway;
+
+		update->addr = NULL;
+		update->netmask = NULL;
+		update->gateway = NULL;
+	}
+	if (update->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_STATE))
+		diff->state = update->state;
+	if (update->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_FAVORITE))
+		diff->favorite = update->favorite;
+	if (update->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_SECURITY))
+		diff->security = update->security;
+	if (update->fields & CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH))
+		diff->strength = update->strength;
+
+	diff->fields |= update->fields;
+	update->fields = 0;
+}
 
-	value = g_hash_table_lookup(hash, "Strength");
-	strength = value ? g_value_get_uchar(value) : 0;
+static gboolean is_visible(struct manager_data *data, const char *path)
+{
+	if (data->visible == NULL)
+		return TRUE;
 
-	value = g_hash_table_lookup(hash, "Security");
-	security = value ? g_strjoinv(" ", g_value_get_boxed(value)) : NULL;
+	return g_hash_table_lookup_extended(data->visible, path, NULL, NULL);
+}
 
-	DBG("name %s type %d icon %s", name, type, icon);
+/*
+ * Write the shadowed diffs of the rows that are visible now, or all of
+ * them. They are taken out of the table first since applying them
+ * emits signals.
+ */
+static void shadow_fold(GtkTreeStore *store, struct manager_data *data,
+							gboolean all)
+{
+	GHashTableIter iter;
+	GSList *list, *folded = NULL;
+	gpointer value;
 
-	value = g_hash_table_lookup(hash, "IPv4.Configuration");
-	ipv4 = value ? g_value_get_boxed (value) : NULL;
+	g_hash_table_iter_init(&iter, data->shadow);
+	while (g_hash_table_iter_next(&iter, NULL, &value) == TRUE) {
+		struct service_diff *diff = value;
 
-	if (!ipv4)
-		goto done;
+		if (all == FALSE && is_visible(data, diff->path) == FALSE)
+			continue;
 
-	ipv4_method = g_hash_table_lookup (ipv4, "Method");
-	method = ipv4_method ? g_value_get_string(ipv4_method) : NULL;
+		g_hash_table_iter_steal(&iter);
+		folded = g_slist_prepend(folded, diff);
+	}
 
-	ipv4_address = g_hash_table_lookup (ipv4, "Address");
-	addr = ipv4_address ? g_value_get_string(ipv4_address) : NULL;
+	for (list = folded; list; list = list->next) {
+		diff_apply(store, list->data);
+		diff_free(list->data);
+	}
 
-	ipv4_netmask = g_hash_table_lookup (ipv4, "Netmask");
-	netmask = ipv4_netmask ? g_value_get_string(ipv4_netmask) : NULL;
+	g_slist_free(folded);
+}
 
-	ipv4_gateway = g_hash_table_lookup (ipv4, "Gateway");
-	gateway = ipv4_gateway ? g_value_get_string(ipv4_gateway) : NULL;
+static gboolean shadow_flush(gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+	struct manager_data *data = get_manager_data(store);
 
-	if (get_iter_from_proxy(store, &iter, proxy) == FALSE) {
-		GtkTreeIter label_iter;
-		guint label_type;
+	DBG("store %p shadowed %d", store, g_hash_table_size(data->shadow));
 
-		switch (type) {
-		case CONNMAN_TYPE_ETHERNET:
-			label_type = CONNMAN_TYPE_LABEL_ETHERNET;
-			break;
-		case CONNMAN_TYPE_WIFI:
-			label_type = CONNMAN_TYPE_LABEL_WIFI;
-			break;
-		case CONNMAN_TYPE_CELLULAR:
-			label_type = CONNMAN_TYPE_LABEL_CELLULAR;
-			break;
-		default:
-			label_type = CONNMAN_TYPE_UNKNOWN;
-			break;
-		}
+	data->shadow_id = 0;
 
-		get_iter_from_type(store, &label_iter, label_type);
+	shadow_fold(store, data, TRUE);
 
-		gtk_tree_store_insert_after(store, &iter, NULL, &label_iter);
+	return FALSE;
+}
 
-		dbus_g_proxy_add_signal(proxy, "PropertyChanged",
-				G_TYPE_STRING, G_TYPE_VALUE, G_TYPE_INVALID);
-		dbus_g_proxy_connect_signal(proxy, "PropertyChanged",
-				G_CALLBACK(service_changed), store, NULL);
+/* Returns FALSE when the diff has to be written now */
+static gboolean shadow_add(GtkTreeStore *store, struct manager_data *data,
+						struct service_diff *diff)
+{
+	struct service_diff *shadow;
+	GtkTreeIter iter;
+	guint strength;
+	gchar *path;
+
+	if (is_visible(data, diff->path) == TRUE || diff->removed == TRUE ||
+			diff->properties != NULL ||
+				(diff->fields & ~DIFF_DEFERRABLE) != 0)
+		return FALSE;
+
+	if (get_iter_from_path(store, &iter, diff->path) == FALSE) {
+		diff_free(diff);
+		return TRUE;
 	}
 
-	gtk_tree_store_set(store, &iter,
-				CONNMAN_COLUMN_PROXY, proxy,
-				CONNMAN_COLUMN_NAME, name,
-				CONNMAN_COLUMN_ICON, icon,
-				CONNMAN_COLUMN_TYPE, type,
-				CONNMAN_COLUMN_STATE, state,
-				CONNMAN_COLUMN_FAVORITE, favorite,
-				CONNMAN_COLUMN_SECURITY, security,
-				CONNMAN_COLUMN_STRENGTH, strength,
-				CONNMAN_COLUMN_METHOD, method,
-				CONNMAN_COLUMN_ADDRESS, addr,
-				CONNMAN_COLUMN_NETMASK, netmask,
-				CONNMAN_COLUMN_GATEWAY, gateway,
-				-1);
+	shadow = g_hash_table_lookup(data->shadow, diff->path);
+	if (shadow != NULL)
+		strength = shadow->strength;
+	else
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
+				CONNMAN_COLUMN_STRENGTH, &strength, -1);
 
-done:
-	g_object_unref(proxy);
-}
+	if (strength == diff->strength) {
+		diff_free(diff);
+		return TRUE;
+	}
 
-static void manager_changed(DBusGProxy *proxy, const char *property,
-					GValue *value, gpointer user_data)
-{
-	GtkTreeStore *store = user_data;
+	path = g_strdup(diff->path);
 
-	DBG("store %p proxy %p property %s", store, proxy, property);
+	if (shadow != NULL) {
+		diff_merge(shadow, diff);
+		diff_free(diff);
+	} else
+		g_hash_table_insert(data->shadow, diff->path, diff);
 
-	if (property == NULL || value == NULL)
+	if (data->shadow_id == 0)
+		data->shadow_id = g_timeout_add_seconds(SHADOW_INTERVAL,
+							shadow_flush, store);
+
+	/* Only the store waits, everybody else hears of it now */
+	notify_event(store, CONNMAN_DBUS_SERVICE_CHANGED, path,
+				CONNMAN_CHANGED(CONNMAN_COLUMN_STRENGTH));
+
+	g_free(path);
+
+	return TRUE;
+}
+
+static void service_properties(GtkTreeStore *store, const char *path,
+							GHashTable *hash);
+
+static void diff_write(GtkTreeStore *store, struct service_diff *diff)
+{
+	GtkTreeIter iter;
+
+	if (diff->removed == TRUE &&
+			get_iter_from_path(store, &iter, diff->path) == TRUE) {
+		gtk_tree_store_remove(store, &iter);
+		notify_event(store, CONNMAN_DBUS_SERVICE_REMOVED,
+							diff->path, 0);
+	}
+
+	if (diff->properties != NULL)
+		service_properties(store, diff->path, diff->properties);
+
+	if (diff->fields != 0)
+		diff_apply(store, diff);
+}
+
+/*
+ * Write the queued diffs in arrival order. Returns TRUE if the budget
+ * in milliseconds ran out first; a budget of 0 writes them all.
+ */
+static gboolean diff_run(GtkTreeStore *store, struct manager_data *data,
+							guint budget)
+{
+	struct service_diff *diff, *shadow;
+
+	g_timer_start(data->diff_timer);
+
+	while ((diff = g_queue_pop_head(data->diff_queue)) != NULL) {
+		if (diff_pending(diff) == FALSE) {
+			diff_free(diff);
+			continue;
+		}
+
+		g_hash_table_remove(data->diffs, diff->path);
+
+		if (shadow_add(store, data, diff) == TRUE)
+			continue;
+
+		/* Anything shadowed for the row is older, write it along */
+		shadow = g_hash_table_lookup(data->shadow, diff->path);
+		if (shadow != NULL && (diff->removed == TRUE ||
+					diff->properties != NULL))
+			g_hash_table_remove(data->shadow, diff->path);
+		else if (shadow != NULL) {
+			g_hash_table_steal(data->shadow, diff->path);
+			diff_merge(shadow, diff);
+			diff_free(diff);
+			diff = shadow;
+		}
+
+		diff_write(store, diff);
+		diff_free(diff);
+
+		if (budget > 0 && g_timer_elapsed(data->diff_timer,
+						NULL) * 1000 >= budget)
+			break;
+	}
+
+	return g_queue_is_empty(data->diff_queue) == FALSE;
+}
+
+static gboolean diff_flush(gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+	struct manager_data *data = get_manager_data(store);
+
+	if (diff_run(store, data, DIFF_BUDGET) == TRUE)
+		return TRUE;
+
+	data->diff_id = 0;
+
+	return FALSE;
+}
+
+void connman_dbus_flush(GtkTreeStore *store)
+{
+	struct manager_data *data = get_manager_data(store);
+
+	if (data == NULL)
+		return;
+
+	diff_run(store, data, 0);
+
+	if (data->diff_id > 0) {
+		g_source_remove(data->diff_id);
+		data->diff_id = 0;
+	}
+}
+
+/*
+ * A full set of properties from a manager reply is newer than whatever
+ * is still queued for the service, a queued removal or addition too.
+ */
+static void diff_drop(GtkTreeStore *store, const char *path)
+{
+	struct manager_data *data = get_manager_data(store);
+	struct service_diff *diff;
+
+	if (data == NULL || path == NULL)
+		return;
+
+	g_hash_table_remove(data->shadow, path);
+
+	diff = g_hash_table_lookup(data->diffs, path);
+	if (diff == NULL)
+		return;
+
+	g_hash_table_remove(data->diffs, path);
+
+	diff_clear_properties(diff);
+
+	diff->removed = FALSE;
+	diff->fields = 0;
+}
+
+static void diff_push(GtkTreeStore *store, struct manager_data *data,
+						struct service_diff *diff)
+{
+	g_hash_table_insert(data->diffs, diff->path, diff);
+	g_queue_push_tail(data->diff_queue, diff);
+
+	if (data->diff_id == 0)
+		data->diff_id = g_idle_add(diff_flush, store);
+}
+
+/* The queued diff of the service, a new one if there is none */
+static struct service_diff *diff_get(GtkTreeStore *store,
+				struct manager_data *data, const char *path)
+{
+	struct service_diff *diff;
+
+	diff = g_hash_table_lookup(data->diffs, path);
+	if (diff != NULL)
+		return diff;
+
+	diff = g_new0(struct service_diff, 1);
+	diff->path = g_strdup(path);
+
+	diff_push(store, data, diff);
+
+	return diff;
+}
+
+static void service_changed(GtkTreeStore *store, const char *path,
+					const char *property, GValue *value)
+{
+	struct manager_data *data = get_manager_data(store);
+	struct service_diff *diff;
+	gboolean queued = TRUE;
+
+	DBG("store %p path %s property %s", store, path, property);
+
+	if (data == NULL || property == NULL || value == NULL)
+		return;
+
+	diff = g_hash_table_lookup(data->diffs, path);
+	if (diff == NULL) {
+		diff = g_new0(struct service_diff, 1);
+		diff->path = g_strdup(path);
+		queued = FALSE;
+	}
+
+	if (diff_decode(diff, property, value) == FALSE) {
+		if (queued == FALSE)
+			diff_free(diff);
+		return;
+	}
+
+	if (queued == TRUE)
+		return;
+
+	diff_push(store, data, diff);
+}
+
+/* Nothing queued before the removal matters any more */
+static void service_removed(GtkTreeStore *store, const char *path)
+{
+	struct manager_data *data = get_manager_data(store);
+	struct service_diff *diff;
+
+	if (data == NULL || path == NULL)
+		return;
+
+	diff = diff_get(store, data, path);
+
+	diff_clear_properties(diff);
+
+	diff->removed = TRUE;
+	diff->fields = 0;
+}
+
+/* The full set replaces the fields queued so far, but not a removal */
+static void service_added(GtkTreeStore *store, const char *path,
+							GHashTable *hash)
+{
+	struct manager_data *data = get_manager_data(store);
+	struct service_diff *diff;
+
+	if (data == NULL || path == NULL || hash == NULL)
+		return;
+
+	diff = diff_get(store, data, path);
+
+	/* The signal's copy is gone by the time the queue is drained */
+	diff_clear_properties(diff);
+
+	diff->properties = g_boxed_copy(DBUS_TYPE_G_DICTIONARY, hash);
+	diff->fields = 0;
+}
+
+static gboolean service_parse(GHashTable *hash, struct service_data *service)
+{
+	GValue *value;
+	GHashTable *ipv4;
+
+	if (hash == NULL)
+		return FALSE;
+
+	value = g_hash_table_lookup(hash, "IPv4.Configuration");
+	ipv4 = value ? g_value_get_boxed (value) : NULL;
+
+	if (!ipv4)
+		return FALSE;
+
+	service->name = get_string(hash, "Name");
+
+	value = g_hash_table_lookup(hash, "Type");
+	service->type = get_type(value);
+	service->icon = g_intern_static_string(type2icon(service->type));
+
+	service->state = g_intern_string(get_string(hash, "State"));
+
+	value = g_hash_table_lookup(hash, "Favorite");
+	service->favorite = value ? g_value_get_boolean(value) : FALSE;
+
+	value = g_hash_table_lookup(hash, "Strength");
+	service->strength = value ? g_value_get_uchar(value) : 0;
+
+	service->security = get_security(g_hash_table_lookup(hash,
+								"Security"));
+
+	service->method = g_intern_string(get_string(ipv4, "Method"));
+	service->addr = get_string(ipv4, "Address");
+	service->netmask = get_string(ipv4, "Netmask");
+	service->gateway = get_string(ipv4, "Gateway");
+
+	DBG("name %s type %d icon %s", service->name, service->type,
+							service->icon);
+
+	return TRUE;
+}
+
+static guint type2label(guint type)
+{
+	switch (type) {
+	case CONNMAN_TYPE_ETHERNET:
+		return CONNMAN_TYPE_LABEL_ETHERNET;
+	case CONNMAN_TYPE_WIFI:
+		return CONNMAN_TYPE_LABEL_WIFI;
+	case CONNMAN_TYPE_CELLULAR:
+		return CONNMAN_TYPE_LABEL_CELLULAR;
+	}
+
+	return CONNMAN_TYPE_UNKNOWN;
+}
+
+static void service_insert(GtkTreeStore *store, GtkTreeIter *iter,
+				gint position, const char *path,
+				struct service_data *service)
+{
+	diff_drop(store, path);
+
+	gtk_tree_store_insert_with_values(store, iter, NULL, position,
+				CONNMAN_COLUMN_PATH, g_intern_string(path),
+				CONNMAN_COLUMN_NAME, service->name,
+				CONNMAN_COLUMN_ICON, service->icon,
+				CONNMAN_COLUMN_TYPE, service->type,
+				CONNMAN_COLUMN_STATE, service->state,
+				CONNMAN_COLUMN_FAVORITE, service->favorite,
+				CONNMAN_COLUMN_SECURITY, service->security,
+				CONNMAN_COLUMN_STRENGTH, service->strength,
+				CONNMAN_COLUMN_METHOD, service->method,
+				CONNMAN_COLUMN_ADDRESS, service->addr,
+				CONNMAN_COLUMN_NETMASK, service->netmask,
+				CONNMAN_COLUMN_GATEWAY, service->gateway,
+				-1);
+
+	notify_event(store, CONNMAN_DBUS_SERVICE_ADDED, path, 0);
+}
+
+static void service_add(GtkTreeStore *store, const char *path,
+					struct service_data *service)
+{
+	GtkTreeIter iter, label_iter;
+	GtkTreePath *label_path;
+	gint position = -1;
+
+	if (get_iter_from_type(store, &label_iter,
+				type2label(service->type)) == TRUE) {
+		label_path = gtk_tree_model_get_path(GTK_TREE_MODEL(store),
+							&label_iter);
+		position = gtk_tree_path_get_indices(label_path)[0] + 1;
+		gtk_tree_path_free(label_path);
+	}
+
+	service_insert(store, &iter, position, path, service);
+}
+
+static void service_properties(GtkTreeStore *store, const char *path,
+							GHashTable *hash)
+{
+	struct service_data service;
+	GtkTreeIter iter;
+	guint changed;
+
+	DBG("store %p path %s hash %p", store, path, hash);
+
+	if (service_parse(hash, &service) == FALSE)
+		return;
+
+	if (get_iter_from_path(store, &iter, path) == FALSE) {
+		service_add(store, path, &service);
+		return;
+	}
+
+	diff_drop(store, path);
+
+	changed = service_store(store, &iter, &service);
+	if (changed != 0)
+		notify_event(store, CONNMAN_DBUS_SERVICE_CHANGED,
+							path, changed);
+}
+
+static void manager_changed(DBusGProxy *proxy, const char *property,
+					GValue *value, gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+
+	DBG("store %p proxy %p property %s", store, proxy, property);
+
+	CONNMAN_PROBE2(signal_entry, "PropertyChanged", CONNMAN_MANAGER_PATH);
+
+	if (property != NULL && value != NULL &&
+			g_str_equal(property, "OfflineMode") == TRUE)
+		offline_mode_changed(store, value);
+
+	CONNMAN_PROBE2(signal_return, "PropertyChanged", CONNMAN_MANAGER_PATH);
+}
+
+static void apply_properties(GtkTreeStore *store, DBusGProxy *proxy,
+							GHashTable *hash)
+{
+	GValue *value;
+
+	value = g_hash_table_lookup(hash, "OfflineMode");
+	if (value != NULL)
+		offline_mode_properties(store, value);
+}
+
+static void apply_technologies(GtkTreeStore *store, DBusGProxy *proxy,
+							GPtrArray *array)
+{
+	unsigned int i;
+
+	for (i = 0; i < array->len; i++)
+	{
+		GValueArray *item = g_ptr_array_index(array, i);
+
+		DBusGObjectPath *path = (DBusGObjectPath *)g_value_get_boxed(g_value_array_get_nth(item, 0));
+		GHashTable *props = (GHashTable *)g_value_get_boxed(g_value_array_get_nth(item, 1));
+
+		tech_added(proxy, path, props, store);
+	}
+}
+
+static void update_services(DBusGProxy *proxy, GPtrArray *added,
+                            GPtrArray *removed, gpointer user_data)
+{
+	GtkTreeStore *store;
+	unsigned int i;
+
+	DBG("proxy %p store %p added %p removed %p", proxy, user_data, added, removed);
+
+	store = GTK_TREE_STORE (user_data);
+
+	CONNMAN_PROBE2(signal_entry, "ServicesChanged", CONNMAN_MANAGER_PATH);
+
+	/* Handle the removed services first as a micro-optimisation */
+	if (removed) {
+		for (i = 0; i < removed->len; i++)
+			{
+				DBusGObjectPath *path;
+				path = (DBusGObjectPath *)g_ptr_array_index(removed, i);
+				DBG("removed path %s", path);
+				service_removed(store, (const char *) path);
+			}
+	}
+
+	if (added) {
+		for (i = 0; i < added->len; i++)
+			{
+				GHashTable *props;
+				GValueArray *item = g_ptr_array_index(added, i);
+
+				DBusGObjectPath *path = (DBusGObjectPath *)g_value_get_boxed(g_value_array_get_nth(item, 0));
+				DBG("added path %s", path);
+
+				props = (GHashTable *)g_value_get_boxed(g_value_array_get_nth(item, 1));
+				service_added(store, path, props);
+			}
+	}
+
+	CONNMAN_PROBE2(signal_return, "ServicesChanged", CONNMAN_MANAGER_PATH);
+}
+
+/* Bit of a label type in the masks used by publish_services() */
+#define LABEL_BIT(type)	(1 << (type))
+
+static void insert_services(GtkTreeStore *store, GtkTreeIter *iter,
+			gint *position, GPtrArray *services, guint labels,
+							GHashTable *present)
+{
+	struct service_data service;
+	unsigned int i;
+	guint label;
+
+	for (i = 0; i < services->len; i++) {
+		GValueArray *item = g_ptr_array_index(services, i);
+		const char *path = g_value_get_boxed(g_value_array_get_nth(item, 0));
+		GHashTable *hash = g_value_get_boxed(g_value_array_get_nth(item, 1));
+
+		if (hash == NULL)
+			continue;
+
+		label = type2label(get_type(g_hash_table_lookup(hash, "Type")));
+		if ((labels & LABEL_BIT(label)) == 0)
+			continue;
+
+		/* Added by a ServicesChanged while the replies were pending */
+		if (g_hash_table_lookup_extended(present, path,
+							NULL, NULL) == TRUE)
+			continue;
+
+		if (service_parse(hash, &service) == FALSE)
+			continue;
+
+		service_insert(store, iter, *position, path, &service);
+
+		if (*position >= 0)
+			(*position)++;
+	}
+}
+
+static void publish_services(GtkTreeStore *store, GPtrArray *services)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	GHashTable *present;
+	GtkTreeIter iter;
+	gboolean cont;
+	gint position = 0;
+	const char *path;
+	guint type, seen = 0;
+
+	present = g_hash_table_new(g_str_hash, g_str_equal);
+
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &path,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+		if (path != NULL && CONNMAN_TYPE_IS_SERVICE(type))
+			g_hash_table_insert(present, (gpointer) path, NULL);
+
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	/*
+	 * Walk the labels once and insert each group of services in
+	 * daemon order right below its label. Services without a label
+	 * row go to the end.
+	 */
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+		position++;
+
+		switch (type) {
+		case CONNMAN_TYPE_LABEL_ETHERNET:
+		case CONNMAN_TYPE_LABEL_WIFI:
+		case CONNMAN_TYPE_LABEL_CELLULAR:
+			seen |= LABEL_BIT(type);
+			insert_services(store, &iter, &position, services,
+						LABEL_BIT(type), present);
+			break;
+		}
+
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	position = -1;
+	insert_services(store, &iter, &position, services, ~seen, present);
+
+	g_hash_table_destroy(present);
+}
+
+static gboolean is_label(guint type)
+{
+	switch (type) {
+	case CONNMAN_TYPE_LABEL_ETHERNET:
+	case CONNMAN_TYPE_LABEL_WIFI:
+	case CONNMAN_TYPE_LABEL_CELLULAR:
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static DBusGProxy *proxy_pool_get(const char *path, const char *interface)
+{
+	DBusGProxy *proxy;
+	GList *list;
+
+	if (proxy_pool == NULL)
+		proxy_pool = g_queue_new();
+
+	for (list = proxy_pool->head; list; list = list->next) {
+		proxy = list->data;
+
+		if (g_str_equal(dbus_g_proxy_get_path(proxy), path) == FALSE ||
+				g_str_equal(dbus_g_proxy_get_interface(proxy),
+							interface) == FALSE)
+			continue;
+
+		g_queue_unlink(proxy_pool, list);
+		g_queue_push_head_link(proxy_pool, list);
+
+		return g_object_ref(proxy);
+	}
+
+	proxy = dbus_g_proxy_new_for_name(connection, CONNMAN_SERVICE,
+							path, interface);
+	if (proxy == NULL)
+		return NULL;
+
+	g_queue_push_head(proxy_pool, proxy);
+
+	if (g_queue_get_length(proxy_pool) > PROXY_POOL_SIZE)
+		g_object_unref(g_queue_pop_tail(proxy_pool));
+
+	return g_object_ref(proxy);
+}
+
+static void proxy_pool_flush(void)
+{
+	DBusGProxy *proxy;
+
+	if (proxy_pool == NULL)
+		return;
+
+	while ((proxy = g_queue_pop_head(proxy_pool)) != NULL)
+		g_object_unref(proxy);
+
+	g_queue_free(proxy_pool);
+	proxy_pool = NULL;
+}
+
+DBusGProxy *connman_dbus_get_proxy(GtkTreeStore *store, const gchar *path)
+{
+	const char *interface;
+	GtkTreeIter iter;
+	guint type;
+
+	if (get_iter_from_path(store, &iter, path) == FALSE)
+		return NULL;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(store), &iter,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+	if (type == CONNMAN_TYPE_SYSCONFIG)
+		interface = CONNMAN_MANAGER_INTERFACE;
+	else if (is_label(type) == TRUE)
+		interface = CONNMAN_TECHNOLOGY_INTERFACE;
+	else
+		interface = CONNMAN_SERVICE_INTERFACE;
+
+	return proxy_pool_get(path, interface);
+}
+
+static GHashTable *get_path_table(GPtrArray *array)
+{
+	GHashTable *table;
+	unsigned int i;
+
+	table = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (i = 0; i < array->len; i++) {
+		GValueArray *item = g_ptr_array_index(array, i);
+		const char *path = g_value_get_boxed(g_value_array_get_nth(item, 0));
+
+		g_hash_table_insert(table, (gpointer) path,
+				g_value_get_boxed(g_value_array_get_nth(item, 1)));
+	}
+
+	return table;
+}
+
+/*
+ * Remove the label rows (or the service rows) whose object path is not
+ * in the table and, when rows is not NULL, collect the remaining ones.
+ */
+static void remove_stale(GtkTreeStore *store, GHashTable *table,
+					gboolean labels, GHashTable *rows)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	GtkTreeIter iter;
+	const char *path;
+	gboolean cont;
+	guint type;
+
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter,
+					CONNMAN_COLUMN_PATH, &path,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+		if (path == NULL || type == CONNMAN_TYPE_SYSCONFIG ||
+						is_label(type) != labels) {
+			cont = gtk_tree_model_iter_next(model, &iter);
+			continue;
+		}
+
+		if (g_hash_table_lookup_extended(table, path,
+						NULL, NULL) == FALSE) {
+			DBG("removed path %s", path);
+			cont = gtk_tree_store_remove(store, &iter);
+			if (labels == FALSE)
+				notify_event(store, CONNMAN_DBUS_SERVICE_REMOVED,
+								path, 0);
+		} else {
+			if (rows != NULL)
+				g_hash_table_insert(rows, g_strdup(path),
+						g_memdup(&iter, sizeof(iter)));
+			cont = gtk_tree_model_iter_next(model, &iter);
+		}
+	}
+}
+
+static void resync_technologies(GtkTreeStore *store, DBusGProxy *proxy,
+							GPtrArray *array)
+{
+	GHashTable *table = get_path_table(array);
+
+	remove_stale(store, table, TRUE, NULL);
+	g_hash_table_destroy(table);
+
+	apply_technologies(store, proxy, array);
+}
+
+struct row_order {
+	gint position;
+	guint type;
+	guint rank;		/* index in the daemon's list of services */
+};
+
+static gint compare_rank(gconstpointer a, gconstpointer b,
+							gpointer user_data)
+{
+	const struct row_order *row_a = a, *row_b = b;
+
+	if (row_a->rank != row_b->rank)
+		return row_a->rank < row_b->rank ? -1 : 1;
+
+	return row_a->position - row_b->position;
+}
+
+static guint order_services(struct row_order *sorted, guint count,
+					guint labels, gint *order, guint i)
+{
+	guint j;
+
+	for (j = 0; j < count; j++) {
+		if (labels & LABEL_BIT(type2label(sorted[j].type)))
+			order[i++] = sorted[j].position;
+	}
+
+	return i;
+}
+
+/*
+ * connmand sorts its services again after every scan. Move the rows
+ * into the order a fresh publish would give them: each label followed
+ * by its services in daemon order and the services without a label
+ * row at the end. Nothing is emitted when the order already holds.
+ */
+static void reorder_services(GtkTreeStore *store, GPtrArray *services)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	struct row_order *rows, *sorted;
+	GHashTable *ranks;
+	GtkTreeIter iter;
+	gboolean cont, moved = FALSE;
+	const char *path;
+	gpointer rank;
+	gint *order;
+	guint i, j, count, n_sorted = 0, type, seen = 0;
+
+	count = gtk_tree_model_iter_n_children(model, NULL);
+	if (count == 0)
+		return;
+
+	ranks = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (i = 0; i < services->len; i++) {
+		GValueArray *item = g_ptr_array_index(services, i);
+
+		g_hash_table_insert(ranks,
+			g_value_get_boxed(g_value_array_get_nth(item, 0)),
+							GUINT_TO_POINTER(i));
+	}
+
+	rows = g_new(struct row_order, count);
+	sorted = g_new(struct row_order, count);
+	order = g_new(gint, count);
+
+	i = 0;
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE && i < count) {
+		gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &path,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+		rows[i].position = i;
+		rows[i].type = type;
+		rows[i].rank = G_MAXUINT;
+
+		if (CONNMAN_TYPE_IS_SERVICE(type)) {
+			if (path != NULL && g_hash_table_lookup_extended(ranks,
+						path, NULL, &rank) == TRUE)
+				rows[i].rank = GPOINTER_TO_UINT(rank);
+
+			sorted[n_sorted++] = rows[i];
+		}
+
+		i++;
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	g_qsort_with_data(sorted, n_sorted, sizeof(*sorted),
+							compare_rank, NULL);
+
+	for (i = 0, j = 0; j < count; j++) {
+		type = rows[j].type;
+
+		if (CONNMAN_TYPE_IS_SERVICE(type))
+			continue;
+
+		order[i++] = rows[j].position;
+
+		if (is_label(type) == FALSE || (seen & LABEL_BIT(type)))
+			continue;
+
+		seen |= LABEL_BIT(type);
+		i = order_services(sorted, n_sorted, LABEL_BIT(type), order, i);
+	}
+
+	order_services(sorted, n_sorted, ~seen, order, i);
+
+	for (j = 0; j < count; j++) {
+		if (order[j] != (gint) j)
+			moved = TRUE;
+	}
+
+	if (moved == TRUE) {
+		DBG("store %p reordering %u rows", store, count);
+		gtk_tree_store_reorder(store, NULL, order);
+	}
+
+	g_free(order);
+	g_free(sorted);
+	g_free(rows);
+	g_hash_table_destroy(ranks);
+}
+
+static void resync_services(GtkTreeStore *store, GPtrArray *services)
+{
+	GHashTable *table, *rows;
+	struct service_data service;
+	GtkTreeIter *iter;
+	unsigned int i;
+	guint changed;
+
+	table = get_path_table(services);
+	rows = g_hash_table_new_full(g_str_hash, g_str_equal,
+							g_free, g_free);
+
+	remove_stale(store, table, FALSE, rows);
+
+	for (i = 0; i < services->len; i++) {
+		GValueArray *item = g_ptr_array_index(services, i);
+		const char *path = g_value_get_boxed(g_value_array_get_nth(item, 0));
+		GHashTable *hash = g_value_get_boxed(g_value_array_get_nth(item, 1));
+
+		if (service_parse(hash, &service) == FALSE)
+			continue;
+
+		iter = g_hash_table_lookup(rows, path);
+		if (iter != NULL) {
+			diff_drop(store, path);
+			changed = service_store(store, iter, &service);
+			if (changed != 0)
+				notify_event(store, CONNMAN_DBUS_SERVICE_CHANGED,
+							path, changed);
+			continue;
+		}
+
+		DBG("added path %s", path);
+
+		service_add(store, path, &service);
+	}
+
+	g_hash_table_destroy(rows);
+	g_hash_table_destroy(table);
+
+	reorder_services(store, services);
+}
+
+static void manager_publish(GtkTreeStore *store, DBusGProxy *proxy,
+					struct manager_data *data)
+{
+	DBG("store %p proxy %p loaded %d", store, proxy, data->loaded);
+
+	if (data->properties != NULL) {
+		apply_properties(store, proxy, data->properties);
+		g_hash_table_destroy(data->properties);
+		data->properties = NULL;
+	}
+
+	if (data->technologies != NULL) {
+		if (data->loaded == TRUE)
+			resync_technologies(store, proxy, data->technologies);
+		else
+			apply_technologies(store, proxy, data->technologies);
+
+		g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+							data->technologies);
+		data->technologies = NULL;
+	}
+
+	if (data->services != NULL) {
+		if (data->loaded == TRUE)
+			resync_services(store, data->services);
+		else
+			publish_services(store, data->services);
+
+		g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+							data->services);
+		data->services = NULL;
+	}
+
+	if (data->loaded == TRUE)
+		return;
+
+	data->loaded = TRUE;
+
+	notify_event(store, CONNMAN_DBUS_POPULATED, NULL, 0);
+}
+
+static void manager_received(GtkTreeStore *store, DBusGProxy *proxy,
+					struct manager_data *data, guint reply)
+{
+	data->pending &= ~reply;
+
+	if (data->pending == 0)
+		manager_publish(store, proxy, data);
+}
+
+static void manager_properties(DBusGProxy *proxy, GHashTable *hash,
+					GError *error, gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+	struct manager_data *data = get_manager_data(store);
+
+	DBG("store %p proxy %p hash %p", store, proxy, hash);
+
+	if (error != NULL) {
+		g_error_free(error);
+		hash = NULL;
+	} else
+		connman_profile_mark(CONNMAN_PROFILE_PROPERTIES);
+
+	if (data != NULL && data->pending & MANAGER_PROPERTIES) {
+		data->properties = hash;
+		manager_received(store, proxy, data, MANAGER_PROPERTIES);
 		return;
+	}
 
-	if (g_str_equal(property, "OfflineMode") == TRUE)
-		offline_mode_changed(store, value);
+	if (hash == NULL)
+		return;
+
+	apply_properties(store, proxy, hash);
+	g_hash_table_destroy(hash);
 }
 
-static void manager_properties(DBusGProxy *proxy, GHashTable *hash,
-					GError *error, gpointer user_data)
+static void manager_services(DBusGProxy *proxy, GPtrArray *services,
+                             GError *error, gpointer user_data)
 {
 	GtkTreeStore *store = user_data;
-	GValue *value;
+	struct manager_data *data = get_manager_data(store);
 
-	DBG("store %p proxy %p hash %p", store, proxy, hash);
+	DBG("proxy %p store %p services %p", proxy, user_data, services);
+
+	if (error != NULL) {
+		g_message ("Error getting services: %s", error->message);
+		g_error_free(error);
+		services = NULL;
+	}
 
-	if (error != NULL || hash == NULL)
+	if (data != NULL && data->pending & MANAGER_SERVICES) {
+		data->services = services;
+		manager_received(store, proxy, data, MANAGER_SERVICES);
 		return;
+	}
 
-	value = g_hash_table_lookup(hash, "OfflineMode");
-	if (value != NULL)
-		offline_mode_properties(store, proxy, value);
+	if (services == NULL)
+		return;
+
+	update_services (proxy, services, NULL, user_data);
+	g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY, services);
 }
 
-static void update_services(DBusGProxy *proxy, GPtrArray *added,
-                            GPtrArray *removed, gpointer user_data)
+static void manager_technologies(DBusGProxy *proxy, GPtrArray *array,
+					GError *error, gpointer user_data)
 {
+	GtkTreeStore *store = user_data;
+	struct manager_data *data = get_manager_data(store);
+
+	DBG("proxy %p array %p", proxy, array);
+
+	if (error != NULL) {
+		g_error_free(error);
+		array = NULL;
+	}
+
+	if (data != NULL && data->pending & MANAGER_TECHNOLOGIES) {
+		data->technologies = array;
+		manager_received(store, proxy, data, MANAGER_TECHNOLOGIES);
+		return;
+	}
+
+	if (array == NULL)
+		return;
+
+	apply_technologies(store, proxy, array);
+	g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY, array);
+}
+
+/*
+ * Every query round has its own generation. A reply that arrives after
+ * the next round started, for example from the daemon that just went
+ * away, must neither clear a pending bit of the new round nor be mixed
+ * into its result.
+ */
+struct manager_call {
 	GtkTreeStore *store;
-	GtkTreeIter iter;
-	unsigned int i;
+	guint generation;
+};
 
-	DBG("proxy %p store %p added %p removed %p", proxy, user_data, added, removed);
+static struct manager_call *manager_call_new(GtkTreeStore *store,
+						struct manager_data *data)
+{
+	struct manager_call *call = g_new0(struct manager_call, 1);
 
-	store = GTK_TREE_STORE (user_data);
+	call->store = store;
+	call->generation = data->generation;
 
-	/* Handle the removed services first as a micro-optimisation */
-	if (removed) {
-		for (i = 0; i < removed->len; i++)
-			{
-				DBusGObjectPath *path;
-				path = (DBusGObjectPath *)g_ptr_array_index(removed, i);
-				DBG("removed path %s", path);
-				if (get_iter_from_path(store, &iter, path))
-					gtk_tree_store_remove(store, &iter);
-			}
+	return call;
+}
+
+static gboolean manager_call_current(struct manager_call *call)
+{
+	struct manager_data *data = get_manager_data(call->store);
+
+	if (data != NULL && data->generation == call->generation)
+		return TRUE;
+
+	DBG("store %p dropping reply of round %u", call->store,
+							call->generation);
+
+	return FALSE;
+}
+
+static void properties_reply(DBusGProxy *proxy, GHashTable *hash,
+					GError *error, gpointer user_data)
+{
+	struct manager_call *call = user_data;
+
+	if (manager_call_current(call) == TRUE)
+		manager_properties(proxy, hash, error, call->store);
+	else {
+		if (error != NULL)
+			g_error_free(error);
+		if (hash != NULL)
+			g_hash_table_destroy(hash);
 	}
 
-	if (added) {
-		for (i = 0; i < added->len; i++)
-			{
-				GHashTable *props;
-				GValueArray *item = g_ptr_array_index(added, i);
+	g_free(call);
+}
 
-				DBusGObjectPath *path = (DBusGObjectPath *)g_value_get_boxed(g_value_array_get_nth(item, 0));
-				DBusGProxy *service_proxy = dbus_g_proxy_new_for_name(connection,
-										      CONNMAN_SERVICE, path,
-										      CONNMAN_SERVICE_INTERFACE);
-				DBG("added path %s", path);
-				if (service_proxy == NULL)
-					continue;
+static void technologies_reply(DBusGProxy *proxy, GPtrArray *array,
+					GError *error, gpointer user_data)
+{
+	struct manager_call *call = user_data;
+
+	if (manager_call_current(call) == TRUE)
+		manager_technologies(proxy, array, error, call->store);
+	else {
+		if (error != NULL)
+			g_error_free(error);
+		if (array != NULL)
+			g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+									array);
+	}
 
-				props = (GHashTable *)g_value_get_boxed(g_value_array_get_nth(item, 1));
-				service_properties(service_proxy, props, user_data);
-			}
+	g_free(call);
+}
+
+static void services_reply(DBusGProxy *proxy, GPtrArray *services,
+					GError *error, gpointer user_data)
+{
+	struct manager_call *call = user_data;
+
+	if (manager_call_current(call) == TRUE)
+		manager_services(proxy, services, error, call->store);
+	else {
+		if (error != NULL)
+			g_error_free(error);
+		if (services != NULL)
+			g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY,
+								services);
 	}
+
+	g_free(call);
 }
 
-static void manager_services(DBusGProxy *proxy, GPtrArray *services,
-                             GError *error, gpointer user_data)
+static void manager_query(DBusGProxy *proxy, GtkTreeStore *store,
+						struct manager_data *data)
 {
-	DBG("proxy %p store %p services %p", proxy, user_data, services);
+	/* Whatever the previous round staged is out of date now */
+	manager_data_unstage(data);
 
-	if (error != NULL) {
-		g_message ("Error getting services: %s", error->message);
+	data->generation++;
+	data->pending = MANAGER_PROPERTIES | MANAGER_TECHNOLOGIES |
+							MANAGER_SERVICES;
+
+	/* Without a bus the replies come from connman_dbus_replay() */
+	if (proxy == NULL)
+		return;
+
+	DBG("getting manager properties");
+
+	connman_get_properties_async(proxy, properties_reply,
+					manager_call_new(store, data));
+
+	DBG("getting technologies");
+
+	connman_get_technologies_async(proxy, technologies_reply,
+					manager_call_new(store, data));
+
+	DBG("getting services");
+
+	connman_get_services_async(proxy, services_reply,
+					manager_call_new(store, data));
+}
+
+static guint message_args(DBusMessage *message, GValue *args, guint size)
+{
+	DBusMessageIter iter;
+	guint n_args = 0;
+
+	if (dbus_message_iter_init(message, &iter) == FALSE)
+		return 0;
+
+	do {
+		if (connman_trace_get_value(&iter, &args[n_args]) == FALSE)
+			break;
+
+		n_args++;
+	} while (n_args < size && dbus_message_iter_next(&iter) == TRUE);
+
+	return n_args;
+}
+
+static void owner_set(struct manager_data *data, const char *owner)
+{
+	DBG("owner %s", owner);
+
+	g_free(data->owner);
+	data->owner = (owner != NULL && *owner != '\0') ?
+						g_strdup(owner) : NULL;
+}
+
+static void owner_reply(DBusPendingCall *call, void *user_data)
+{
+	GtkTreeStore *store = user_data;
+	struct manager_data *data = get_manager_data(store);
+	DBusMessage *reply;
+	const char *owner;
+
+	reply = dbus_pending_call_steal_reply(call);
+
+	/* An error reply means that nobody owns the name yet */
+	if (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &owner,
+						DBUS_TYPE_INVALID) == TRUE)
+		owner_set(data, owner);
+
+	dbus_message_unref(reply);
+
+	dbus_pending_call_unref(data->owner_call);
+	data->owner_call = NULL;
+}
+
+/*
+ * Ask the bus who owns net.connman. It is sent before the manager's
+ * own calls, so no signal the first query round depends on comes in
+ * while the owner is still unknown.
+ */
+static void owner_query(DBusConnection *bus, GtkTreeStore *store,
+						struct manager_data *data)
+{
+	DBusMessage *message;
+	const char *name = CONNMAN_SERVICE;
+
+	message = dbus_message_new_method_call(DBUS_SERVICE_DBUS,
+			DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "GetNameOwner");
+	if (message == NULL)
 		return;
+
+	dbus_message_append_args(message, DBUS_TYPE_STRING, &name,
+							DBUS_TYPE_INVALID);
+
+	if (dbus_connection_send_with_reply(bus, message,
+					&data->owner_call, -1) == FALSE ||
+						data->owner_call == NULL) {
+		g_printerr("Can't ask for the owner of %s\n", name);
+		goto done;
 	}
 
-	update_services (proxy, services, NULL, user_data);
+	dbus_pending_call_set_notify(data->owner_call, owner_reply,
+								store, NULL);
+
+done:
+	dbus_message_unref(message);
 }
 
-static void manager_technologies(DBusGProxy *proxy, GPtrArray *array,
-					GError *error, gpointer user_data)
+static void owner_changed(GtkTreeStore *store, DBusMessage *message)
 {
-	unsigned int i;
+	struct manager_data *data = get_manager_data(store);
+	const char *name, *prev, *new;
 
-	DBG("proxy %p array %p", proxy, array);
+	if (data == NULL || dbus_message_has_sender(message,
+						DBUS_SERVICE_DBUS) == FALSE)
+		return;
 
-	if (error != NULL || array == NULL)
+	if (dbus_message_get_args(message, NULL,
+				DBUS_TYPE_STRING, &name,
+				DBUS_TYPE_STRING, &prev,
+				DBUS_TYPE_STRING, &new,
+				DBUS_TYPE_INVALID) == FALSE)
 		return;
 
-	for (i = 0; i < array->len; i++)
-	{
-		GValueArray *item = g_ptr_array_index(array, i);
+	if (g_str_equal(name, CONNMAN_SERVICE) == FALSE)
+		return;
 
-		DBusGObjectPath *path = (DBusGObjectPath *)g_value_get_boxed(g_value_array_get_nth(item, 0));
-		GHashTable *props = (GHashTable *)g_value_get_boxed(g_value_array_get_nth(item, 1));
+	owner_set(data, new);
+}
 
-		tech_added(proxy, path, props, user_data);
+/*
+ * Services and technologies have no proxy of their own to deliver their
+ * signals, so their PropertyChanged is picked up here for all of them,
+ * but only from the current owner of net.connman. The message is left
+ * for any other handler on the connection.
+ */
+static DBusHandlerResult signal_filter(DBusConnection *bus,
+				DBusMessage *message, void *user_data)
+{
+	GtkTreeStore *store = user_data;
+	struct manager_data *data;
+	const char *path = dbus_message_get_path(message);
+	const char *property;
+	GValue args[2] = { { 0 }, { 0 } };
+	guint i, n_args;
+
+	if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS,
+					"NameOwnerChanged") == TRUE) {
+		owner_changed(store, message);
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 	}
+
+	if (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_SIGNAL ||
+			g_strcmp0(dbus_message_get_member(message),
+						"PropertyChanged") != 0)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	data = get_manager_data(store);
+	if (data == NULL || data->owner == NULL ||
+			g_strcmp0(dbus_message_get_sender(message),
+							data->owner) != 0)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	n_args = message_args(message, args, G_N_ELEMENTS(args));
+	if (n_args != 2 || G_VALUE_HOLDS_STRING(&args[0]) == FALSE)
+		goto done;
+
+	property = g_value_get_string(&args[0]);
+
+	CONNMAN_PROBE2(signal_entry, "PropertyChanged", path);
+
+	if (dbus_message_has_interface(message,
+					CONNMAN_SERVICE_INTERFACE) == TRUE)
+		service_changed(store, path, property, &args[1]);
+	else if (dbus_message_has_interface(message,
+					CONNMAN_TECHNOLOGY_INTERFACE) == TRUE)
+		tech_update(store, path, property, &args[1]);
+
+	CONNMAN_PROBE2(signal_return, "PropertyChanged", path);
+
+done:
+	for (i = 0; i < n_args; i++)
+		g_value_unset(&args[i]);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
 DBusGProxy *connman_dbus_create_manager(DBusGConnection *conn,
-						GtkTreeStore *store)
+			GtkTreeStore *store, ConnmanDBusNotifyFunc notify,
+							gpointer user_data)
 {
 	DBusGProxy *proxy;
+	DBusConnection *bus;
 	GType changed_type, removed_type;
+	struct manager_data *data;
+
+	data = g_new0(struct manager_data, 1);
+	data->notify = notify;
+	data->user_data = user_data;
+	data->diffs = g_hash_table_new(g_str_hash, g_str_equal);
+	data->diff_queue = g_queue_new();
+	data->diff_timer = g_timer_new();
+	data->shadow = g_hash_table_new_full(g_str_hash, g_str_equal,
+							NULL, diff_free);
+
+	g_object_set_data_full(G_OBJECT(store), "manager", data,
+							manager_data_free);
+
+	if (conn == NULL) {
+		manager_query(NULL, store, data);
+		return NULL;
+	}
 
 	connection = dbus_g_connection_ref(conn);
 
+	bus = dbus_g_connection_get_connection(connection);
+	dbus_connection_add_filter(bus, signal_filter, store, NULL);
+	dbus_bus_add_match(bus, OWNER_MATCH, NULL);
+	dbus_bus_add_match(bus, SERVICE_MATCH, NULL);
+	dbus_bus_add_match(bus, TECHNOLOGY_MATCH, NULL);
+
+	owner_query(bus, store, data);
+
 	proxy = dbus_g_proxy_new_for_name(connection, CONNMAN_SERVICE,
 			CONNMAN_MANAGER_PATH, CONNMAN_MANAGER_INTERFACE);
 
@@ -627,8 +2223,7 @@ DBusGProxy *connman_dbus_create_manager(DBusGConnection *conn,
 	dbus_g_proxy_connect_signal(proxy, "PropertyChanged",
 				G_CALLBACK(manager_changed), store, NULL);
 
-	changed_type = dbus_g_type_get_struct("GValueArray", DBUS_TYPE_G_OBJECT_PATH, DBUS_TYPE_G_DICTIONARY, G_TYPE_INVALID);
-	changed_type = dbus_g_type_get_collection("GPtrArray", changed_type);
+	changed_type = DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY;
         removed_type = DBUS_TYPE_G_OBJECT_PATH_ARRAY;
 	dbus_g_object_register_marshaller(marshal_VOID__BOXED_BOXED,
                                           G_TYPE_NONE,
@@ -652,28 +2247,265 @@ DBusGProxy *connman_dbus_create_manager(DBusGConnection *conn,
 	dbus_g_proxy_connect_signal(proxy, "TechnologyRemoved",
 				G_CALLBACK(tech_removed), store, NULL);
 
+	manager_query(proxy, store, data);
 
-	DBG("getting manager properties");
+	return proxy;
+}
 
-	connman_get_properties_async(proxy, manager_properties, store);
+void connman_dbus_resync(DBusGProxy *proxy, GtkTreeStore *store)
+{
+	struct manager_data *data = get_manager_data(store);
 
-	DBG("getting technologies");
+	DBG("store %p proxy %p", store, proxy);
 
-	connman_get_technologies_async(proxy, manager_technologies, store);
+	if (data == NULL)
+		return;
 
-	DBG("getting services");
+	manager_query(proxy, store, data);
+}
+
+guint connman_dbus_get_suppressed(GtkTreeStore *store)
+{
+	struct manager_data *data = get_manager_data(store);
 
-	connman_get_services_async(proxy, manager_services, store);
+	if (data == NULL)
+		return 0;
 
-	return proxy;
+	return data->suppressed;
+}
+
+void connman_dbus_set_visible(GtkTreeStore *store, GHashTable *paths)
+{
+	struct manager_data *data = get_manager_data(store);
+
+	DBG("store %p paths %d", store,
+			paths != NULL ? g_hash_table_size(paths) : -1);
+
+	if (data == NULL) {
+		if (paths != NULL)
+			g_hash_table_destroy(paths);
+		return;
+	}
+
+	if (data->visible != NULL)
+		g_hash_table_destroy(data->visible);
+
+	data->visible = paths;
+
+	shadow_fold(store, data, FALSE);
+}
+
+gboolean connman_dbus_is_populated(GtkTreeStore *store)
+{
+	struct manager_data *data = get_manager_data(store);
+
+	if (data == NULL)
+		return FALSE;
+
+	return data->loaded;
 }
 
 void connman_dbus_destroy_manager(DBusGProxy *proxy, GtkTreeStore *store)
 {
-	DBG("store %p proxy %p", store, proxy);
+	DBusConnection *bus;
+
+	DBG("store %p proxy %p suppressed %u", store, proxy,
+					connman_dbus_get_suppressed(store));
+
+	g_object_set_data(G_OBJECT(store), "manager", NULL);
+
+	if (proxy == NULL)
+		return;
+
+	bus = dbus_g_connection_get_connection(connection);
+
+	dbus_bus_remove_match(bus, TECHNOLOGY_MATCH, NULL);
+	dbus_bus_remove_match(bus, SERVICE_MATCH, NULL);
+	dbus_bus_remove_match(bus, OWNER_MATCH, NULL);
+	dbus_connection_remove_filter(bus, signal_filter, store);
 
 	g_signal_handlers_disconnect_by_func(proxy, manager_changed, store);
 	g_object_unref(proxy);
 
+	proxy_pool_flush();
+
 	dbus_g_connection_unref(connection);
 }
+
+static void replay_signal(DBusGProxy *manager, GtkTreeStore *store,
+				DBusMessage *message, GValue *args, guint n_args)
+{
+	const char *path = dbus_message_get_path(message);
+	const char *interface = dbus_message_get_interface(message);
+	const char *member = dbus_message_get_member(message);
+	const char *property, *name, *owner;
+
+	if (g_strcmp0(member, "PropertyChanged") == 0) {
+		if (n_args != 2 || G_VALUE_HOLDS_STRING(&args[0]) == FALSE)
+			return;
+
+		property = g_value_get_string(&args[0]);
+
+		if (g_strcmp0(interface, CONNMAN_MANAGER_INTERFACE) == 0)
+			manager_changed(manager, property, &args[1], store);
+		else if (g_strcmp0(interface, CONNMAN_SERVICE_INTERFACE) == 0)
+			service_changed(store, path, property, &args[1]);
+		else if (g_strcmp0(interface,
+					CONNMAN_TECHNOLOGY_INTERFACE) == 0)
+			tech_update(store, path, property, &args[1]);
+	} else if (g_strcmp0(member, "ServicesChanged") == 0) {
+		if (n_args != 2)
+			return;
+
+		update_services(manager, g_value_get_boxed(&args[0]),
+					g_value_get_boxed(&args[1]), store);
+	} else if (g_strcmp0(member, "TechnologyAdded") == 0) {
+		if (n_args != 2)
+			return;
+
+		tech_added(manager, g_value_get_boxed(&args[0]),
+					g_value_get_boxed(&args[1]), store);
+	} else if (g_strcmp0(member, "TechnologyRemoved") == 0) {
+		if (n_args != 1)
+			return;
+
+		tech_removed(manager, g_value_get_boxed(&args[0]), store);
+	} else if (g_strcmp0(member, "NameOwnerChanged") == 0) {
+		if (n_args != 3 || G_VALUE_HOLDS_STRING(&args[0]) == FALSE ||
+				G_VALUE_HOLDS_STRING(&args[2]) == FALSE)
+			return;
+
+		name = g_value_get_string(&args[0]);
+		owner = g_value_get_string(&args[2]);
+
+		/* The daemon came back, query it again like the client does */
+		if (g_strcmp0(name, CONNMAN_SERVICE) == 0 &&
+					owner != NULL && *owner != '\0')
+			connman_dbus_resync(manager, store);
+	}
+}
+
+/*
+ * Hand a reply that can't be told apart by its content to the oldest
+ * manager call among replies that still waits for one. The calls are
+ * made in the order of their MANAGER_* bits, so that is the lowest bit
+ * still pending. Only the empty arrays come with a reply.
+ */
+static void replay_received(DBusGProxy *manager, GtkTreeStore *store,
+				guint replies, gpointer reply, GError *error)
+{
+	struct manager_data *data = get_manager_data(store);
+	guint pending = (data != NULL) ? data->pending & replies : 0;
+
+	switch (pending & ~(pending - 1)) {
+	case MANAGER_PROPERTIES:
+		manager_properties(manager, reply, error, store);
+		return;
+	case MANAGER_TECHNOLOGIES:
+		manager_technologies(manager, reply, error, store);
+		return;
+	case MANAGER_SERVICES:
+		manager_services(manager, reply, error, store);
+		return;
+	}
+
+	if (error != NULL)
+		g_error_free(error);
+
+	if (reply == NULL)
+		return;
+
+	if (replies == MANAGER_PROPERTIES)
+		g_hash_table_destroy(reply);
+	else
+		g_boxed_free(DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY, reply);
+}
+
+static void replay_reply(DBusGProxy *manager, GtkTreeStore *store,
+							GValue *args, guint n_args)
+{
+	GPtrArray *array;
+	GHashTable *hash;
+	GValueArray *item;
+	const char *path;
+
+	if (n_args != 1)
+		return;
+
+	/*
+	 * Replies carry no member name, so tell the manager calls apart
+	 * by their content: GetProperties has the OfflineMode key and
+	 * GetTechnologies returns technology object paths. A dictionary
+	 * without that key is left to the pending bits.
+	 */
+	if (G_VALUE_HOLDS(&args[0], DBUS_TYPE_G_DICTIONARY) == TRUE) {
+		hash = g_value_get_boxed(&args[0]);
+
+		if (g_hash_table_lookup(hash, "OfflineMode") != NULL)
+			manager_properties(manager,
+					g_value_dup_boxed(&args[0]), NULL, store);
+		else
+			replay_received(manager, store, MANAGER_PROPERTIES,
+					g_value_dup_boxed(&args[0]), NULL);
+	} else if (G_VALUE_HOLDS(&args[0],
+			DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY) == TRUE) {
+		array = g_value_get_boxed(&args[0]);
+		if (array->len == 0) {
+			replay_received(manager, store, MANAGER_TECHNOLOGIES |
+						MANAGER_SERVICES,
+						g_value_dup_boxed(&args[0]), NULL);
+			return;
+		}
+
+		item = g_ptr_array_index(array, 0);
+		path = g_value_get_boxed(g_value_array_get_nth(item, 0));
+
+		if (g_str_has_prefix(path, "/net/connman/technology/") == TRUE)
+			manager_technologies(manager,
+					g_value_dup_boxed(&args[0]), NULL, store);
+		else
+			manager_services(manager,
+					g_value_dup_boxed(&args[0]), NULL, store);
+	}
+}
+
+static void replay_error(DBusGProxy *manager, GtkTreeStore *store,
+							DBusMessage *message)
+{
+	DBusError derror;
+	GError *error = NULL;
+
+	dbus_error_init(&derror);
+	dbus_set_error_from_message(&derror, message);
+	dbus_set_g_error(&error, &derror);
+	dbus_error_free(&derror);
+
+	replay_received(manager, store, MANAGER_PROPERTIES |
+			MANAGER_TECHNOLOGIES | MANAGER_SERVICES, NULL, error);
+}
+
+void connman_dbus_replay(DBusGProxy *manager, GtkTreeStore *store,
+						DBusMessage *message)
+{
+	GValue args[3] = { { 0 }, { 0 }, { 0 } };
+	guint i, n_args;
+
+	DBG("store %p message %p", store, message);
+
+	n_args = message_args(message, args, G_N_ELEMENTS(args));
+
+	switch (dbus_message_get_type(message)) {
+	case DBUS_MESSAGE_TYPE_SIGNAL:
+		replay_signal(manager, store, message, args, n_args);
+		break;
+	case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+		replay_reply(manager, store, args, n_args);
+		break;
+	case DBUS_MESSAGE_TYPE_ERROR:
+		replay_error(manager, store, message);
+		break;
+	}
+
+	for (i = 0; i < n_args; i++)
+		g_value_unset(&args[i]);
+}
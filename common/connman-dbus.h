@@ -20,6 +20,7 @@
  */
 
 #include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
 #include <gtk/gtk.h>
 
 #define CONNMAN_SERVICE			"net.connman"
@@ -34,10 +35,79 @@
 #define CONNMAN_SERVICE_INTERFACE	CONNMAN_SERVICE ".Service"
 #define CONNMAN_TECHNOLOGY_INTERFACE	CONNMAN_SERVICE ".Technology"
 
+#ifndef DBUS_TYPE_G_OBJECT_PATH_ARRAY
+#define DBUS_TYPE_G_OBJECT_PATH_ARRAY \
+	(dbus_g_type_get_collection("GPtrArray", DBUS_TYPE_G_OBJECT_PATH))
+#endif
+
+#ifndef DBUS_TYPE_G_DICTIONARY
+#define DBUS_TYPE_G_DICTIONARY \
+	(dbus_g_type_get_map("GHashTable", G_TYPE_STRING, G_TYPE_VALUE))
+#endif
+
+/* a(oa{sv}) as returned by GetServices and GetTechnologies */
+#define DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY \
+	(dbus_g_type_get_collection("GPtrArray", \
+		dbus_g_type_get_struct("GValueArray", DBUS_TYPE_G_OBJECT_PATH, \
+				DBUS_TYPE_G_DICTIONARY, G_TYPE_INVALID)))
+
+enum {
+	CONNMAN_DBUS_POPULATED,
+	CONNMAN_DBUS_SERVICE_ADDED,
+	CONNMAN_DBUS_SERVICE_REMOVED,
+	CONNMAN_DBUS_SERVICE_CHANGED,
+};
+
+/*
+ * path is NULL for CONNMAN_DBUS_POPULATED and changed is only set for
+ * CONNMAN_DBUS_SERVICE_CHANGED, as a mask of CONNMAN_CHANGED() bits.
+ */
+typedef void (* ConnmanDBusNotifyFunc) (guint event, const char *path,
+					guint changed, gpointer user_data);
+
+/* A store with the CONNMAN_COLUMN_* layout the manager fills in */
+GtkTreeStore *connman_dbus_store_new(void);
+
+/*
+ * Without a connection no calls are made and NULL is returned. Such a
+ * store is only fed through connman_dbus_replay().
+ */
 DBusGProxy *connman_dbus_create_manager(DBusGConnection *connection,
-							GtkTreeStore *store);
+			GtkTreeStore *store, ConnmanDBusNotifyFunc notify,
+							gpointer user_data);
 void connman_dbus_destroy_manager(DBusGProxy *proxy, GtkTreeStore *store);
+gboolean connman_dbus_is_populated(GtkTreeStore *store);
+guint connman_dbus_get_suppressed(GtkTreeStore *store);
+void connman_dbus_resync(DBusGProxy *proxy, GtkTreeStore *store);
+
+/*
+ * paths is a set of the object paths a view currently shows and is
+ * owned by the store afterwards; NULL means that everything is shown.
+ */
+void connman_dbus_set_visible(GtkTreeStore *store, GHashTable *paths);
 
+/*
+ * Returns a new reference to a pooled proxy for a row of the store.
+ * Hold it until the reply of any asynchronous call has arrived, since
+ * the pool may drop its own reference at any time.
+ */
 DBusGProxy *connman_dbus_get_proxy(GtkTreeStore *store, const gchar *path);
 gboolean connman_dbus_get_iter(GtkTreeStore *store, const gchar *path,
 							GtkTreeIter *iter);
+
+/*
+ * The current strength of a service, including an update that is still
+ * held back from the store because the row isn't shown.
+ */
+gboolean connman_dbus_get_strength(GtkTreeStore *store, const gchar *path,
+							guint *strength);
+
+/*
+ * Replayed signals take the same queue as live ones, see
+ * connman_dbus_flush() to write it out without a main loop.
+ */
+void connman_dbus_replay(DBusGProxy *manager, GtkTreeStore *store,
+						DBusMessage *message);
+
+/* Writes all queued service updates now, regardless of the budget */
+void connman_dbus_flush(GtkTreeStore *store);
@@ -0,0 +1,255 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "connman-index.h"
+
+#define INDEX_GRAM	3
+
+struct entry {
+	gchar *key;
+	gchar *text;
+};
+
+struct _ConnmanIndex {
+	GHashTable *entries;	/* key -> struct entry */
+	GHashTable *grams;	/* slice -> set of struct entry */
+};
+
+static gchar *index_fold(const char *text)
+{
+	gchar *normal, *fold;
+
+	normal = g_utf8_normalize(text, -1, G_NORMALIZE_ALL);
+	if (normal == NULL)
+		return g_strdup(text);
+
+	fold = g_utf8_casefold(normal, -1);
+	g_free(normal);
+
+	return fold;
+}
+
+static void entry_free(gpointer data)
+{
+	struct entry *entry = data;
+
+	g_free(entry->key);
+	g_free(entry->text);
+	g_free(entry);
+}
+
+/*
+ * Slices are taken over bytes. A query that is a substring of the text
+ * in characters is one in bytes as well, so this never misses a match
+ * and the final strstr() weeds out the rest.
+ */
+static void grams_add(ConnmanIndex *index, struct entry *entry)
+{
+	gsize i, n, len = strlen(entry->text);
+	GHashTable *set;
+	gchar *gram;
+
+	for (i = 0; i < len; i++) {
+		for (n = 1; n <= INDEX_GRAM && i + n <= len; n++) {
+			gram = g_strndup(entry->text + i, n);
+
+			set = g_hash_table_lookup(index->grams, gram);
+			if (set == NULL) {
+				set = g_hash_table_new(g_direct_hash,
+							g_direct_equal);
+				g_hash_table_insert(index->grams, gram, set);
+			} else
+				g_free(gram);
+
+			g_hash_table_insert(set, entry, entry);
+		}
+	}
+}
+
+static void grams_remove(ConnmanIndex *index, struct entry *entry)
+{
+	gsize i, n, len = strlen(entry->text);
+	GHashTable *set;
+	gchar gram[INDEX_GRAM + 1];
+
+	for (i = 0; i < len; i++) {
+		for (n = 1; n <= INDEX_GRAM && i + n <= len; n++) {
+			memcpy(gram, entry->text + i, n);
+			gram[n] = '\0';
+
+			set = g_hash_table_lookup(index->grams, gram);
+			if (set == NULL)
+				continue;
+
+			g_hash_table_remove(set, entry);
+			if (g_hash_table_size(set) == 0)
+				g_hash_table_remove(index->grams, gram);
+		}
+	}
+}
+
+ConnmanIndex *connman_index_new(void)
+{
+	ConnmanIndex *index;
+
+	index = g_new0(ConnmanIndex, 1);
+
+	index->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+							NULL, entry_free);
+	index->grams = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify) g_hash_table_destroy);
+
+	return index;
+}
+
+void connman_index_free(ConnmanIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	g_hash_table_destroy(index->grams);
+	g_hash_table_destroy(index->entries);
+
+	g_free(index);
+}
+
+void connman_index_set(ConnmanIndex *index, const char *key,
+							const char *text)
+{
+	struct entry *entry;
+	gchar *fold;
+
+	if (text == NULL) {
+		connman_index_remove(index, key);
+		return;
+	}
+
+	fold = index_fold(text);
+
+	entry = g_hash_table_lookup(index->entries, key);
+	if (entry != NULL) {
+		if (g_str_equal(entry->text, fold) == TRUE) {
+			g_free(fold);
+			return;
+		}
+
+		grams_remove(index, entry);
+		g_free(entry->text);
+	} else {
+		entry = g_new0(struct entry, 1);
+		entry->key = g_strdup(key);
+		g_hash_table_insert(index->entries, entry->key, entry);
+	}
+
+	entry->text = fold;
+
+	grams_add(index, entry);
+}
+
+void connman_index_remove(ConnmanIndex *index, const char *key)
+{
+	struct entry *entry;
+
+	entry = g_hash_table_lookup(index->entries, key);
+	if (entry == NULL)
+		return;
+
+	grams_remove(index, entry);
+
+	g_hash_table_remove(index->entries, key);
+}
+
+gboolean connman_index_match(ConnmanIndex *index, const char *key,
+							const char *query)
+{
+	struct entry *entry;
+	gboolean match;
+	gchar *fold;
+
+	if (query == NULL || *query == '\0')
+		return TRUE;
+
+	entry = g_hash_table_lookup(index->entries, key);
+	if (entry == NULL)
+		return FALSE;
+
+	fold = index_fold(query);
+	match = strstr(entry->text, fold) != NULL;
+	g_free(fold);
+
+	return match;
+}
+
+GHashTable *connman_index_lookup(ConnmanIndex *index, const char *query)
+{
+	GHashTable *result, *set, *best = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	gsize i, n, len;
+	gchar *fold;
+	gchar gram[INDEX_GRAM + 1];
+
+	if (query == NULL || *query == '\0')
+		return NULL;
+
+	result = g_hash_table_new_full(g_str_hash, g_str_equal,
+							g_free, NULL);
+
+	fold = index_fold(query);
+	len = strlen(fold);
+	n = MIN(len, INDEX_GRAM);
+
+	/* Every slice of the query has to be there, start from the rarest */
+	for (i = 0; i + n <= len; i++) {
+		memcpy(gram, fold + i, n);
+		gram[n] = '\0';
+
+		set = g_hash_table_lookup(index->grams, gram);
+		if (set == NULL) {
+			g_free(fold);
+			return result;
+		}
+
+		if (best == NULL ||
+				g_hash_table_size(set) < g_hash_table_size(best))
+			best = set;
+	}
+
+	g_hash_table_iter_init(&iter, best);
+	while (g_hash_table_iter_next(&iter, NULL, &value) == TRUE) {
+		struct entry *entry = value;
+
+		if (n == len || strstr(entry->text, fold) != NULL) {
+			gchar *key = g_strdup(entry->key);
+			g_hash_table_insert(result, key, key);
+		}
+	}
+
+	g_free(fold);
+
+	return result;
+}
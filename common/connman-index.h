@@ -0,0 +1,50 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <glib.h>
+
+/*
+ * Substring index over short strings such as service names. Every 1, 2
+ * and 3 byte slice of the case folded text maps to the keys holding
+ * it, so a lookup only verifies the keys listed under the rarest slice
+ * of the query instead of scanning every entry. Updates only touch the
+ * slices of the one entry that changed.
+ */
+typedef struct _ConnmanIndex ConnmanIndex;
+
+ConnmanIndex *connman_index_new(void);
+void connman_index_free(ConnmanIndex *index);
+
+/* Add an entry or replace its text; a NULL text removes it */
+void connman_index_set(ConnmanIndex *index, const char *key,
+							const char *text);
+void connman_index_remove(ConnmanIndex *index, const char *key);
+
+/* Case insensitive substring test against a single entry */
+gboolean connman_index_match(ConnmanIndex *index, const char *key,
+							const char *query);
+
+/*
+ * Return a set of the keys whose text contains query, to be freed with
+ * g_hash_table_destroy(), or NULL when the query is empty and matches
+ * everything.
+ */
+GHashTable *connman_index_lookup(ConnmanIndex *index, const char *query);
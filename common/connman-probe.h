@@ -0,0 +1,70 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * USDT probes in the "connman" provider, built in with --enable-sdt and
+ * compiled out otherwise. An unused probe is a single nop, so they can
+ * stay in release builds and be attached to with perf or bpftrace:
+ *
+ *   signal_entry, signal_return (member, path)
+ *	around the handling of every connmand signal
+ *   call (method, path), reply (method, path)
+ *	every ConnmanClient method call, and the reply to async ones
+ *   agent_request (path), agent_cancel ()
+ *	agent RequestInput and Cancel from connmand
+ *   status (name)
+ *	every change of what the status icon shows
+ *   state (path, state)
+ *	every change of a service state applied to the model
+ *
+ * All arguments are strings. Every probe also goes to the flight
+ * recorder in connman-recorder.h, which is always built in and records
+ * once it has been set up.
+ */
+
+#include "connman-recorder.h"
+
+#ifdef HAVE_SDT
+#include <sys/sdt.h>
+
+#define CONNMAN_SDT(name)		DTRACE_PROBE(connman, name)
+#define CONNMAN_SDT1(name, a)		DTRACE_PROBE1(connman, name, a)
+#define CONNMAN_SDT2(name, a, b)	DTRACE_PROBE2(connman, name, a, b)
+#else
+#define CONNMAN_SDT(name)
+#define CONNMAN_SDT1(name, a)
+#define CONNMAN_SDT2(name, a, b)
+#endif
+
+#define CONNMAN_PROBE(name) do { \
+	connman_recorder_record(#name, NULL, NULL); \
+	CONNMAN_SDT(name); \
+} while (0)
+
+#define CONNMAN_PROBE1(name, a) do { \
+	connman_recorder_record(#name, a, NULL); \
+	CONNMAN_SDT1(name, a); \
+} while (0)
+
+#define CONNMAN_PROBE2(name, a, b) do { \
+	connman_recorder_record(#name, a, b); \
+	CONNMAN_SDT2(name, a, b); \
+} while (0)
@@ -0,0 +1,179 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "connman-profile.h"
+
+#define PROFILE_MARKS	16
+#define PROFILE_TIMEOUT	30	/* seconds */
+
+struct profile_mark {
+	const char *milestone;
+	gdouble time;
+};
+
+static GTimer *profile_timer = NULL;
+static struct profile_mark profile_marks[PROFILE_MARKS];
+static guint profile_count = 0;
+static const char **profile_milestones = NULL;
+static guint profile_timeout = 0;
+
+void connman_profile_start(void)
+{
+	if (profile_timer != NULL)
+		return;
+
+	profile_timer = g_timer_new();
+}
+
+static struct profile_mark *profile_lookup(const char *milestone)
+{
+	guint i;
+
+	for (i = 0; i < profile_count; i++) {
+		if (g_str_equal(profile_marks[i].milestone, milestone) == TRUE)
+			return &profile_marks[i];
+	}
+
+	return NULL;
+}
+
+static void profile_stop(void)
+{
+	if (profile_timeout > 0) {
+		g_source_remove(profile_timeout);
+		profile_timeout = 0;
+	}
+
+	g_timer_destroy(profile_timer);
+	profile_timer = NULL;
+
+	profile_milestones = NULL;
+}
+
+static void profile_dump(void)
+{
+	const char *filename = g_getenv("CONNMAN_PROFILE_STARTUP");
+	FILE *file = stderr;
+	gdouble last = 0.0;
+	guint i;
+
+	if (filename != NULL && *filename != '\0') {
+		file = fopen(filename, "w");
+		if (file == NULL) {
+			g_printerr("Can't open profile file %s\n", filename);
+			file = stderr;
+		}
+	}
+
+	fprintf(file, "Startup timeline of %s:\n", g_get_prgname());
+
+	for (i = 0; i < profile_count; i++) {
+		fprintf(file, "%9.1f ms  %+9.1f ms  %s\n",
+				profile_marks[i].time * 1000,
+				(profile_marks[i].time - last) * 1000,
+				profile_marks[i].milestone);
+		last = profile_marks[i].time;
+	}
+
+	for (i = 0; profile_milestones[i] != NULL; i++) {
+		if (profile_lookup(profile_milestones[i]) == NULL)
+			fprintf(file, "%9s     %9s     %s\n", "-", "-",
+						profile_milestones[i]);
+	}
+
+	if (file != stderr)
+		fclose(file);
+}
+
+static gboolean profile_complete(void)
+{
+	guint i;
+
+	for (i = 0; profile_milestones[i] != NULL; i++) {
+		if (profile_lookup(profile_milestones[i]) == NULL)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean profile_expired(gpointer user_data)
+{
+	profile_timeout = 0;
+
+	profile_dump();
+	profile_stop();
+
+	return FALSE;
+}
+
+void connman_profile_setup(gboolean enabled, const char **milestones)
+{
+	if (profile_timer == NULL)
+		return;
+
+	if (enabled == FALSE && g_getenv("CONNMAN_PROFILE_STARTUP") == NULL) {
+		profile_stop();
+		return;
+	}
+
+	profile_milestones = milestones;
+
+	if (profile_complete() == TRUE) {
+		profile_dump();
+		profile_stop();
+		return;
+	}
+
+	profile_timeout = g_timeout_add(PROFILE_TIMEOUT * 1000,
+						profile_expired, NULL);
+}
+
+void connman_profile_mark(const char *milestone)
+{
+	struct profile_mark *mark;
+
+	if (profile_timer == NULL)
+		return;
+
+	if (profile_count == PROFILE_MARKS || profile_lookup(milestone) != NULL)
+		return;
+
+	mark = &profile_marks[profile_count++];
+	mark->milestone = milestone;
+	mark->time = g_timer_elapsed(profile_timer, NULL);
+
+	/* Marks made before the setup are kept for the report */
+	if (profile_milestones == NULL)
+		return;
+
+	if (profile_complete() == TRUE) {
+		profile_dump();
+		profile_stop();
+	}
+}
@@ -0,0 +1,45 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <glib.h>
+
+/*
+ * Startup timeline. connman_profile_start() starts the clock and has to
+ * be called first thing in main(); milestones are marked from wherever
+ * they happen and only the first mark of each is kept.
+ *
+ * connman_profile_setup() enables the report when enabled is TRUE or
+ * CONNMAN_PROFILE_STARTUP is set (to a file name, or empty for stderr).
+ * The timeline is written once every milestone in the NULL terminated
+ * list has been marked, or after 30 seconds with the missing ones.
+ */
+void connman_profile_start(void);
+void connman_profile_setup(gboolean enabled, const char **milestones);
+void connman_profile_mark(const char *milestone);
+
+#define CONNMAN_PROFILE_GTK_INIT	"gtk_init done"
+#define CONNMAN_PROFILE_BUS		"bus connected"
+#define CONNMAN_PROFILE_ICONS		"icons loaded"
+#define CONNMAN_PROFILE_AGENT		"agent registered"
+#define CONNMAN_PROFILE_PROPERTIES	"first GetProperties reply"
+#define CONNMAN_PROFILE_PAINTED		"first icon painted"
+#define CONNMAN_PROFILE_WINDOW		"first window painted"
+#define CONNMAN_PROFILE_POPULATED	"model populated"
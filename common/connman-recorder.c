@@ -0,0 +1,232 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "connman-recorder.h"
+
+#define RECORDER_SIZE	512	/* records, a power of two */
+#define RECORDER_ARG	96	/* bytes per argument, longer ones are cut */
+
+/*
+ * The event name is always a string literal from the probe macros. The
+ * arguments are copied into the record, so recording never allocates
+ * and the ring is all the memory the recorder ever takes.
+ */
+struct recorder_record {
+	guint64 time;		/* microseconds since the first record */
+	const char *event;
+	char a[RECORDER_ARG];
+	char b[RECORDER_ARG];
+};
+
+static struct recorder_record recorder_ring[RECORDER_SIZE];
+static guint recorder_next = 0;
+static gboolean recorder_wrapped = FALSE;
+static gboolean recorder_enabled = FALSE;
+
+static GTimer *recorder_timer = NULL;
+static GTimeVal recorder_start;
+
+static int recorder_pipe[2] = { -1, -1 };
+
+void connman_recorder_record(const char *event, const char *a,
+							const char *b)
+{
+	struct recorder_record *record;
+
+	if (recorder_enabled == FALSE)
+		return;
+
+	record = &recorder_ring[recorder_next];
+	record->time = g_timer_elapsed(recorder_timer, NULL) * G_USEC_PER_SEC;
+	record->event = event;
+	g_strlcpy(record->a, a ? a : "", sizeof(record->a));
+	g_strlcpy(record->b, b ? b : "", sizeof(record->b));
+
+	recorder_next = (recorder_next + 1) & (RECORDER_SIZE - 1);
+	if (recorder_next == 0)
+		recorder_wrapped = TRUE;
+}
+
+/*
+ * A previous dump is replaced by a new file rather than written through,
+ * so whatever sits at filename, a planted symlink included, is never
+ * followed.
+ */
+static FILE *dump_open(const char *filename)
+{
+	FILE *file;
+	int fd;
+
+	if (g_unlink(filename) < 0 && errno != ENOENT)
+		return NULL;
+
+	fd = open(filename, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+	if (fd < 0)
+		return NULL;
+
+	file = fdopen(fd, "w");
+	if (file == NULL)
+		close(fd);
+
+	return file;
+}
+
+gboolean connman_recorder_dump(const char *filename)
+{
+	FILE *file;
+	gchar *start;
+	guint i, count, first;
+
+	file = dump_open(filename);
+	if (file == NULL) {
+		g_printerr("Can't open event file %s\n", filename);
+		return FALSE;
+	}
+
+	count = recorder_wrapped == TRUE ? RECORDER_SIZE : recorder_next;
+	first = recorder_wrapped == TRUE ? recorder_next : 0;
+
+	start = recorder_enabled ? g_time_val_to_iso8601(&recorder_start) : NULL;
+
+	fprintf(file, "Last %u bus events of %s, recording since %s:\n",
+				count, g_get_prgname(), start ? start : "-");
+
+	g_free(start);
+
+	for (i = 0; i < count; i++) {
+		struct recorder_record *record;
+
+		record = &recorder_ring[(first + i) & (RECORDER_SIZE - 1)];
+
+		fprintf(file, "%10" G_GUINT64_FORMAT ".%06u  %-14s %s %s\n",
+				record->time / G_USEC_PER_SEC,
+				(guint) (record->time % G_USEC_PER_SEC),
+				record->event, record->a, record->b);
+	}
+
+	if (fclose(file) != 0) {
+		g_printerr("Can't write event file %s\n", filename);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gchar *connman_recorder_filename(void)
+{
+	const char *env = g_getenv("CONNMAN_RECORDER_FILE");
+	gchar *dir, *name, *filename;
+
+	if (env != NULL && *env != '\0')
+		return g_strdup(env);
+
+	/* Private to the user, unlike the shared temporary directory */
+	dir = g_build_filename(g_get_user_cache_dir(), "connman", NULL);
+	if (g_mkdir_with_parents(dir, 0700) < 0)
+		g_printerr("Can't create directory %s\n", dir);
+
+	name = g_strdup_printf("%s-%d.events", g_get_prgname(), (int) getpid());
+	filename = g_build_filename(dir, name, NULL);
+	g_free(name);
+	g_free(dir);
+
+	return filename;
+}
+
+/* Only async-signal-safe work in here, the dump runs from the main loop */
+static void recorder_signal(int signum)
+{
+	int saved = errno;
+
+	if (write(recorder_pipe[1], "", 1) < 0) {
+		/* Pipe full, a dump is pending already */
+	}
+
+	errno = saved;
+}
+
+static gboolean recorder_wakeup(GIOChannel *channel, GIOCondition condition,
+							gpointer user_data)
+{
+	gchar *filename;
+	char buf[16];
+
+	while (read(recorder_pipe[0], buf, sizeof(buf)) > 0)
+		;
+
+	filename = connman_recorder_filename();
+
+	if (connman_recorder_dump(filename) == TRUE)
+		g_printerr("Bus events written to %s\n", filename);
+
+	g_free(filename);
+
+	return TRUE;
+}
+
+void connman_recorder_setup(void)
+{
+	struct sigaction sa;
+	GIOChannel *channel;
+	int i;
+
+	if (recorder_pipe[0] >= 0)
+		return;
+
+	if (pipe(recorder_pipe) < 0) {
+		g_printerr("Can't create event recorder pipe\n");
+		return;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fcntl(recorder_pipe[i], F_SETFL,
+			fcntl(recorder_pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(recorder_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	recorder_timer = g_timer_new();
+	g_get_current_time(&recorder_start);
+	recorder_enabled = TRUE;
+
+	channel = g_io_channel_unix_new(recorder_pipe[0]);
+	g_io_add_watch(channel, G_IO_IN, recorder_wakeup, NULL);
+	g_io_channel_unref(channel);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = recorder_signal;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGUSR1, &sa, NULL);
+}
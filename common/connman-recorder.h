@@ -0,0 +1,41 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <glib.h>
+
+/*
+ * Flight recorder of the most recent bus events. Once
+ * connman_recorder_setup() has been called, every CONNMAN_PROBE point
+ * also lands here, whether or not the USDT probes are built in. A
+ * record costs a clock read and two bounded string copies into a
+ * fixed ring, whose oldest records get overwritten. Before the setup
+ * a probe is a single test.
+ *
+ * connman_recorder_dump() writes the records, oldest first, to the
+ * given file. connman_recorder_setup() makes SIGUSR1 do the same to
+ * CONNMAN_RECORDER_FILE, or to <cachedir>/connman/<prgname>-<pid>.events.
+ * An existing file is replaced, never written through.
+ */
+void connman_recorder_setup(void);
+void connman_recorder_record(const char *event, const char *a,
+							const char *b);
+gboolean connman_recorder_dump(const char *filename);
+gchar *connman_recorder_filename(void);
@@ -0,0 +1,570 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "connman-dbus.h"
+#include "connman-trace.h"
+
+#ifdef DEBUG
+#define DBG(fmt, arg...) printf("%s:%s() " fmt "\n", __FILE__, __FUNCTION__ , ## arg)
+#else
+#define DBG(fmt...)
+#endif
+
+struct trace_record {
+	guint32 delta;
+	guint32 length;
+};
+
+static DBusConnection *trace_connection = NULL;
+static FILE *trace_file = NULL;
+static GTimer *trace_timer = NULL;
+static guint64 trace_last;
+static gchar *trace_owner = NULL;
+static DBusPendingCall *trace_owner_call = NULL;
+
+static void record_message(DBusMessage *message)
+{
+	struct trace_record record;
+	guint64 now;
+	char *data;
+	int length;
+
+	if (dbus_message_marshal(message, &data, &length) == FALSE)
+		return;
+
+	now = g_timer_elapsed(trace_timer, NULL) * G_USEC_PER_SEC;
+
+	record.delta = MIN(now - trace_last, G_MAXUINT32);
+	record.length = length;
+
+	trace_last = now;
+
+	if (fwrite(&record, sizeof(record), 1, trace_file) != 1 ||
+			fwrite(data, length, 1, trace_file) != 1)
+		g_printerr("Writing trace record failed\n");
+
+	dbus_free(data);
+}
+
+static DBusHandlerResult trace_filter(DBusConnection *connection,
+				DBusMessage *message, void *user_data)
+{
+	const char *sender = dbus_message_get_sender(message);
+	const char *name, *prev, *new;
+
+	if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS,
+					"NameOwnerChanged") == TRUE) {
+		if (dbus_message_get_args(message, NULL,
+					DBUS_TYPE_STRING, &name,
+					DBUS_TYPE_STRING, &prev,
+					DBUS_TYPE_STRING, &new,
+					DBUS_TYPE_INVALID) == FALSE)
+			goto done;
+
+		if (g_str_equal(name, CONNMAN_SERVICE) == FALSE)
+			goto done;
+
+		DBG("owner %s", new);
+
+		g_free(trace_owner);
+		trace_owner = (*new != '\0') ? g_strdup(new) : NULL;
+
+		record_message(message);
+		goto done;
+	}
+
+	if (sender == NULL || g_strcmp0(sender, trace_owner) != 0)
+		goto done;
+
+	switch (dbus_message_get_type(message)) {
+	case DBUS_MESSAGE_TYPE_SIGNAL:
+	case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+	case DBUS_MESSAGE_TYPE_ERROR:
+		record_message(message);
+		break;
+	}
+
+done:
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void owner_reply(DBusPendingCall *call, void *user_data)
+{
+	DBusMessage *reply;
+	const char *owner;
+
+	reply = dbus_pending_call_steal_reply(call);
+
+	/* An error reply means that nobody owns the name yet */
+	if (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &owner,
+						DBUS_TYPE_INVALID) == TRUE) {
+		DBG("owner %s", owner);
+
+		g_free(trace_owner);
+		trace_owner = g_strdup(owner);
+	}
+
+	dbus_message_unref(reply);
+
+	dbus_pending_call_unref(trace_owner_call);
+	trace_owner_call = NULL;
+}
+
+/*
+ * The bus answers this itself, so the reply is in before anything the
+ * client asks connmand afterwards.
+ */
+static void owner_query(DBusConnection *connection)
+{
+	DBusMessage *message;
+	const char *name = CONNMAN_SERVICE;
+
+	message = dbus_message_new_method_call(DBUS_SERVICE_DBUS,
+			DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "GetNameOwner");
+	if (message == NULL)
+		return;
+
+	dbus_message_append_args(message, DBUS_TYPE_STRING, &name,
+							DBUS_TYPE_INVALID);
+
+	if (dbus_connection_send_with_reply(connection, message,
+					&trace_owner_call, -1) == TRUE &&
+						trace_owner_call != NULL)
+		dbus_pending_call_set_notify(trace_owner_call, owner_reply,
+								NULL, NULL);
+
+	dbus_message_unref(message);
+}
+
+gboolean connman_trace_start(DBusGConnection *connection,
+						const char *filename)
+{
+
+	DBG("filename %s", filename);
+
+	if (connection == NULL || trace_file != NULL)
+		return FALSE;
+
+	trace_file = fopen(filename, "wb");
+	if (trace_file == NULL) {
+		g_printerr("Can't open trace file %s\n", filename);
+		return FALSE;
+	}
+
+	fwrite(CONNMAN_TRACE_MAGIC, strlen(CONNMAN_TRACE_MAGIC), 1, trace_file);
+
+	trace_timer = g_timer_new();
+	trace_last = 0;
+
+	trace_connection = dbus_g_connection_get_connection(connection);
+	dbus_connection_ref(trace_connection);
+	dbus_connection_add_filter(trace_connection, trace_filter, NULL, NULL);
+
+	owner_query(trace_connection);
+
+	return TRUE;
+}
+
+void connman_trace_stop(void)
+{
+	DBG("");
+
+	if (trace_file == NULL)
+		return;
+
+	if (trace_owner_call != NULL) {
+		dbus_pending_call_cancel(trace_owner_call);
+		dbus_pending_call_unref(trace_owner_call);
+		trace_owner_call = NULL;
+	}
+
+	dbus_connection_remove_filter(trace_connection, trace_filter, NULL);
+	dbus_connection_unref(trace_connection);
+	trace_connection = NULL;
+
+	fclose(trace_file);
+	trace_file = NULL;
+
+	g_timer_destroy(trace_timer);
+	trace_timer = NULL;
+
+	g_free(trace_owner);
+	trace_owner = NULL;
+}
+
+struct trace_replay {
+	FILE *file;
+	ConnmanTraceFunc func;
+	ConnmanTraceDoneFunc done;
+	gpointer user_data;
+	DBusMessage *pending;
+	guint count;
+};
+
+static DBusMessage *read_message(FILE *file, guint32 *delta)
+{
+	struct trace_record record;
+	DBusMessage *message;
+	DBusError error;
+	char *data;
+
+	if (fread(&record, sizeof(record), 1, file) != 1)
+		return NULL;
+
+	data = g_try_malloc(record.length);
+	if (data == NULL)
+		return NULL;
+
+	if (fread(data, record.length, 1, file) != 1) {
+		g_free(data);
+		return NULL;
+	}
+
+	dbus_error_init(&error);
+
+	message = dbus_message_demarshal(data, record.length, &error);
+	if (message == NULL) {
+		g_printerr("Invalid trace record: %s\n", error.message);
+		dbus_error_free(&error);
+	}
+
+	g_free(data);
+
+	if (delta != NULL)
+		*delta = record.delta;
+
+	return message;
+}
+
+static void replay_finish(struct trace_replay *replay)
+{
+	DBG("replayed %d messages", replay->count);
+
+	fclose(replay->file);
+
+	if (replay->done != NULL)
+		replay->done(replay->count, replay->user_data);
+
+	g_free(replay);
+}
+
+static gboolean replay_timeout(gpointer user_data)
+{
+	struct trace_replay *replay = user_data;
+	guint32 delta;
+
+	do {
+		replay->func(replay->pending, replay->user_data);
+		dbus_message_unref(replay->pending);
+		replay->count++;
+
+		replay->pending = read_message(replay->file, &delta);
+		if (replay->pending == NULL) {
+			replay_finish(replay);
+			return FALSE;
+		}
+	} while (delta < 1000);
+
+	g_timeout_add(delta / 1000, replay_timeout, replay);
+
+	return FALSE;
+}
+
+gboolean connman_trace_replay(const char *filename, gboolean realtime,
+				ConnmanTraceFunc func, ConnmanTraceDoneFunc done,
+							gpointer user_data)
+{
+	struct trace_replay *replay;
+	char magic[sizeof(CONNMAN_TRACE_MAGIC)];
+	DBusMessage *message;
+	guint32 delta;
+	FILE *file;
+
+	DBG("filename %s realtime %d", filename, realtime);
+
+	file = fopen(filename, "rb");
+	if (file == NULL) {
+		g_printerr("Can't open trace file %s\n", filename);
+		return FALSE;
+	}
+
+	if (fread(magic, strlen(CONNMAN_TRACE_MAGIC), 1, file) != 1 ||
+			strncmp(magic, CONNMAN_TRACE_MAGIC,
+					strlen(CONNMAN_TRACE_MAGIC)) != 0) {
+		g_printerr("%s is not a trace file\n", filename);
+		fclose(file);
+		return FALSE;
+	}
+
+	replay = g_new0(struct trace_replay, 1);
+	replay->file = file;
+	replay->func = func;
+	replay->done = done;
+	replay->user_data = user_data;
+
+	if (realtime == FALSE) {
+		while ((message = read_message(file, NULL)) != NULL) {
+			func(message, user_data);
+			dbus_message_unref(message);
+			replay->count++;
+		}
+
+		replay_finish(replay);
+		return TRUE;
+	}
+
+	replay->pending = read_message(file, &delta);
+	if (replay->pending == NULL) {
+		replay_finish(replay);
+		return TRUE;
+	}
+
+	g_timeout_add(delta / 1000, replay_timeout, replay);
+
+	return TRUE;
+}
+
+static void free_value(gpointer data)
+{
+	GValue *value = data;
+
+	g_value_unset(value);
+	g_free(value);
+}
+
+static gboolean get_dictionary(DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter array, entry;
+	GHashTable *hash;
+	const char *key;
+	GValue *item;
+
+	hash = g_hash_table_new_full(g_str_hash, g_str_equal,
+							g_free, free_value);
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse(&array, &entry);
+
+		if (dbus_message_iter_get_arg_type(&entry) != DBUS_TYPE_STRING)
+			goto failed;
+
+		dbus_message_iter_get_basic(&entry, &key);
+		dbus_message_iter_next(&entry);
+
+		item = g_new0(GValue, 1);
+
+		if (connman_trace_get_value(&entry, item) == FALSE) {
+			g_free(item);
+			goto failed;
+		}
+
+		g_hash_table_insert(hash, g_strdup(key), item);
+
+		dbus_message_iter_next(&array);
+	}
+
+	g_value_init(value, DBUS_TYPE_G_DICTIONARY);
+	g_value_take_boxed(value, hash);
+
+	return TRUE;
+
+failed:
+	g_hash_table_destroy(hash);
+
+	return FALSE;
+}
+
+static gboolean get_object_properties(DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter array, entry;
+	GValueArray *item;
+	GPtrArray *list;
+	GValue field = { 0 };
+
+	list = g_ptr_array_new();
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT) {
+		item = g_value_array_new(2);
+		g_ptr_array_add(list, item);
+
+		dbus_message_iter_recurse(&array, &entry);
+
+		while (dbus_message_iter_get_arg_type(&entry) !=
+							DBUS_TYPE_INVALID) {
+			if (connman_trace_get_value(&entry, &field) == FALSE)
+				goto failed;
+
+			g_value_array_append(item, &field);
+			g_value_unset(&field);
+
+			dbus_message_iter_next(&entry);
+		}
+
+		dbus_message_iter_next(&array);
+	}
+
+	g_value_init(value, DBUS_TYPE_G_OBJECT_PROPERTIES_ARRAY);
+	g_value_take_boxed(value, list);
+
+	return TRUE;
+
+failed:
+	g_ptr_array_foreach(list, (GFunc) g_value_array_free, NULL);
+	g_ptr_array_free(list, TRUE);
+
+	return FALSE;
+}
+
+static gboolean get_array(DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter array;
+	GPtrArray *list;
+	const char *str;
+	char *signature;
+	gboolean valid;
+
+	switch (dbus_message_iter_get_element_type(iter)) {
+	case DBUS_TYPE_DICT_ENTRY:
+		return get_dictionary(iter, value);
+	case DBUS_TYPE_STRUCT:
+		signature = dbus_message_iter_get_signature(iter);
+		valid = g_str_equal(signature, "a(oa{sv})");
+		dbus_free(signature);
+
+		if (valid == FALSE)
+			return FALSE;
+
+		return get_object_properties(iter, value);
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		break;
+	default:
+		return FALSE;
+	}
+
+	list = g_ptr_array_new();
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) != DBUS_TYPE_INVALID) {
+		dbus_message_iter_get_basic(&array, &str);
+		g_ptr_array_add(list, g_strdup(str));
+		dbus_message_iter_next(&array);
+	}
+
+	if (dbus_message_iter_get_element_type(iter) == DBUS_TYPE_STRING) {
+		g_ptr_array_add(list, NULL);
+		g_value_init(value, G_TYPE_STRV);
+		g_value_take_boxed(value, g_ptr_array_free(list, FALSE));
+	} else {
+		g_value_init(value, DBUS_TYPE_G_OBJECT_PATH_ARRAY);
+		g_value_take_boxed(value, list);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Decode the argument at iter into value using the same GValue types
+ * dbus-glib hands to signal and reply callbacks, so recorded messages
+ * can be fed to the connman-dbus.c handlers unchanged.  Only the types
+ * used by the net.connman API are supported.
+ */
+gboolean connman_trace_get_value(DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter variant;
+	const char *str;
+	dbus_bool_t boolean;
+	unsigned char byte;
+	dbus_uint16_t uint16;
+	dbus_int16_t int16;
+	dbus_uint32_t uint32;
+	dbus_int32_t int32;
+	double number;
+
+	switch (dbus_message_iter_get_arg_type(iter)) {
+	case DBUS_TYPE_STRING:
+		dbus_message_iter_get_basic(iter, &str);
+		g_value_init(value, G_TYPE_STRING);
+		g_value_set_string(value, str);
+		break;
+	case DBUS_TYPE_OBJECT_PATH:
+		dbus_message_iter_get_basic(iter, &str);
+		g_value_init(value, DBUS_TYPE_G_OBJECT_PATH);
+		g_value_set_boxed(value, str);
+		break;
+	case DBUS_TYPE_BOOLEAN:
+		dbus_message_iter_get_basic(iter, &boolean);
+		g_value_init(value, G_TYPE_BOOLEAN);
+		g_value_set_boolean(value, boolean);
+		break;
+	case DBUS_TYPE_BYTE:
+		dbus_message_iter_get_basic(iter, &byte);
+		g_value_init(value, G_TYPE_UCHAR);
+		g_value_set_uchar(value, byte);
+		break;
+	case DBUS_TYPE_UINT16:
+		dbus_message_iter_get_basic(iter, &uint16);
+		g_value_init(value, G_TYPE_UINT);
+		g_value_set_uint(value, uint16);
+		break;
+	case DBUS_TYPE_INT16:
+		dbus_message_iter_get_basic(iter, &int16);
+		g_value_init(value, G_TYPE_INT);
+		g_value_set_int(value, int16);
+		break;
+	case DBUS_TYPE_UINT32:
+		dbus_message_iter_get_basic(iter, &uint32);
+		g_value_init(value, G_TYPE_UINT);
+		g_value_set_uint(value, uint32);
+		break;
+	case DBUS_TYPE_INT32:
+		dbus_message_iter_get_basic(iter, &int32);
+		g_value_init(value, G_TYPE_INT);
+		g_value_set_int(value, int32);
+		break;
+	case DBUS_TYPE_DOUBLE:
+		dbus_message_iter_get_basic(iter, &number);
+		g_value_init(value, G_TYPE_DOUBLE);
+		g_value_set_double(value, number);
+		break;
+	case DBUS_TYPE_VARIANT:
+		dbus_message_iter_recurse(iter, &variant);
+		return connman_trace_get_value(&variant, value);
+	case DBUS_TYPE_ARRAY:
+		return get_array(iter, value);
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
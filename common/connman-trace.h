@@ -0,0 +1,44 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License version 2.1 as published by the Free Software Foundation.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+
+/*
+ * A trace file starts with the CONNMAN_TRACE_MAGIC bytes followed by
+ * one record per message: the microseconds elapsed since the previous
+ * record and the length of the marshalled message (both guint32 in host
+ * byte order), then the message as produced by dbus_message_marshal().
+ */
+#define CONNMAN_TRACE_MAGIC	"CMTRACE1"
+
+typedef void (* ConnmanTraceFunc) (DBusMessage *message, gpointer user_data);
+typedef void (* ConnmanTraceDoneFunc) (guint count, gpointer user_data);
+
+gboolean connman_trace_start(DBusGConnection *connection,
+						const char *filename);
+void connman_trace_stop(void);
+
+gboolean connman_trace_replay(const char *filename, gboolean realtime,
+				ConnmanTraceFunc func, ConnmanTraceDoneFunc done,
+							gpointer user_data);
+
+gboolean connman_trace_get_value(DBusMessageIter *iter, GValue *value);
@@ -28,12 +28,16 @@
 #include <gtk/gtk.h>
 
 #include "instance.h"
+#include "connman-recorder.h"
 
 #define CONNMAN_SERVICE    "net.connman"
 #define CONNMAN_INSTANCE   CONNMAN_SERVICE ".Instance"
 
 static DBusGConnection *connection;
 
+/* Kept until cleanup, disposing it would cancel the pending request */
+static DBusGProxy *request_proxy;
+
 static GtkWindow *instance_window;
 
 static gboolean instance_present(GObject *self, GError **error)
@@ -43,6 +47,22 @@ static gboolean instance_present(GObject *self, GError **error)
 	return TRUE;
 }
 
+static gboolean instance_dump_events(GObject *self, gchar **filename,
+							GError **error)
+{
+	*filename = connman_recorder_filename();
+
+	if (connman_recorder_dump(*filename) == FALSE) {
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+					"Can't write %s", *filename);
+		g_free(*filename);
+		*filename = NULL;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 #include "instance-glue.h"
 
 void instance_register(GtkWindow *window)
@@ -55,42 +75,89 @@ void instance_register(GtkWindow *window)
 	dbus_g_connection_register_g_object(connection, "/", G_OBJECT(window));
 }
 
-gboolean instance_init(const gchar *name)
+struct request_data {
+	gchar *name;
+	InstanceCallback callback;
+	gpointer user_data;
+};
+
+static void request_data_free(gpointer user_data)
 {
-	DBusGProxy *proxy;
+	struct request_data *data = user_data;
+
+	g_free(data->name);
+	g_free(data);
+}
+
+static void request_reply(DBusGProxy *proxy, DBusGProxyCall *call,
+							gpointer user_data)
+{
+	struct request_data *data = user_data;
 	GError *error = NULL;
 	guint result;
 
-	connection = dbus_g_bus_get(DBUS_BUS_SESSION, &error);
-	if (error != NULL) {
-		g_printerr("Can't get session bus: %s", error->message);
-		g_error_free(error);
-		return FALSE;
+	if (dbus_g_proxy_end_call(proxy, call, &error, G_TYPE_UINT, &result,
+						G_TYPE_INVALID) == FALSE) {
+		/* Without an answer there is no other instance to defer to */
+		g_printerr("Can't get unique name on session bus: %s\n",
+						error ? error->message : "");
+		if (error != NULL)
+			g_error_free(error);
+		data->callback(TRUE, data->user_data);
+		return;
 	}
 
-	proxy = dbus_g_proxy_new_for_name(connection, DBUS_SERVICE_DBUS,
-					DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
+	if (result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+		DBusGProxy *instance;
 
-	if (dbus_g_proxy_call(proxy, "RequestName", NULL,
-			G_TYPE_STRING, name, G_TYPE_UINT, 0, G_TYPE_INVALID,
-			G_TYPE_UINT, &result, G_TYPE_INVALID) == FALSE) {
-		g_printerr("Can't get unique name on session bus");
-		g_object_unref(proxy);
-		dbus_g_connection_unref(connection);
+		instance = dbus_g_proxy_new_for_name(connection, data->name,
+						"/", CONNMAN_INSTANCE);
+
+		dbus_g_proxy_call_no_reply(instance, "Present",
+					G_TYPE_INVALID, G_TYPE_INVALID);
+
+		g_object_unref(G_OBJECT(instance));
+
+		data->callback(FALSE, data->user_data);
+		return;
+	}
+
+	data->callback(TRUE, data->user_data);
+}
+
+gboolean instance_init(const gchar *name, InstanceCallback callback,
+							gpointer user_data)
+{
+	struct request_data *data;
+	DBusGProxyCall *call;
+	GError *error = NULL;
+
+	connection = dbus_g_bus_get(DBUS_BUS_SESSION, &error);
+	if (error != NULL) {
+		g_printerr("Can't get session bus: %s\n", error->message);
+		g_error_free(error);
+		connection = NULL;
 		return FALSE;
 	}
 
-	g_object_unref(proxy);
+	request_proxy = dbus_g_proxy_new_for_name(connection,
+				DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+						DBUS_INTERFACE_DBUS);
 
-	if (result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
-		proxy = dbus_g_proxy_new_for_name(connection, name, "/",
-						CONNMAN_SERVICE ".Instance");
+	data = g_new0(struct request_data, 1);
+	data->name = g_strdup(name);
+	data->callback = callback;
+	data->user_data = user_data;
 
-		dbus_g_proxy_call_no_reply(proxy, "Present",
-					G_TYPE_INVALID, G_TYPE_INVALID);
+	call = dbus_g_proxy_begin_call(request_proxy, "RequestName",
+					request_reply, data, request_data_free,
+					G_TYPE_STRING, name, G_TYPE_UINT, 0,
+					G_TYPE_INVALID);
 
-		g_object_unref(G_OBJECT(proxy));
-		dbus_g_connection_unref(connection);
+	if (call == NULL) {
+		g_printerr("Can't get unique name on session bus\n");
+		request_data_free(data);
+		instance_cleanup();
 		return FALSE;
 	}
 
@@ -99,5 +166,13 @@ gboolean instance_init(const gchar *name)
 
 void instance_cleanup(void)
 {
+	if (connection == NULL)
+		return;
+
+	if (request_proxy != NULL)
+		g_object_unref(request_proxy);
+	request_proxy = NULL;
+
 	dbus_g_connection_unref(connection);
+	connection = NULL;
 }
@@ -19,7 +19,16 @@
  *
  */
 
-gboolean instance_init(const gchar *name);
+/*
+ * Ask for the well-known name without blocking. The callback runs once
+ * the bus has answered: TRUE when this process owns the name, FALSE
+ * when another instance does and has been asked to present itself.
+ * Returns FALSE, without calling back, if the session bus is missing.
+ */
+typedef void (* InstanceCallback) (gboolean primary, gpointer user_data);
+
+gboolean instance_init(const gchar *name, InstanceCallback callback,
+							gpointer user_data);
 void instance_cleanup(void);
 
 void instance_register(GtkWindow *window);
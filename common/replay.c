@@ -0,0 +1,133 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <dbus/dbus-glib.h>
+#include <gtk/gtk.h>
+
+#include "connman-dbus.h"
+#include "connman-trace.h"
+
+/*
+ * The messages are fed to a store that has no bus behind it, so the
+ * replay never talks to a running connmand.
+ */
+
+static gboolean option_realtime = FALSE;
+
+static GOptionEntry options[] = {
+	{ "realtime", 'r', 0, G_OPTION_ARG_NONE, &option_realtime,
+				"Replay with the recorded timing", NULL },
+	{ NULL },
+};
+
+static GMainLoop *mainloop;
+static GTimer *timer;
+static gboolean finished = FALSE;
+
+static gboolean count_row(GtkTreeModel *model, GtkTreePath *path,
+					GtkTreeIter *iter, gpointer user_data)
+{
+	guint *rows = user_data;
+
+	(*rows)++;
+
+	return FALSE;
+}
+
+static void replay_message(DBusMessage *message, gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+
+	connman_dbus_replay(NULL, store, message);
+}
+
+static void replay_done(guint count, gpointer user_data)
+{
+	GtkTreeStore *store = user_data;
+	gdouble elapsed;
+	guint rows = 0;
+
+	/* Updates still queued count towards the replay */
+	connman_dbus_flush(store);
+
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	gtk_tree_model_foreach(GTK_TREE_MODEL(store), count_row, &rows);
+
+	g_print("Replayed %d messages in %.3f seconds (%.0f/s), %d rows\n",
+				count, elapsed, count / elapsed, rows);
+
+	/* Without --realtime this runs before the main loop does */
+	finished = TRUE;
+
+	g_main_loop_quit(mainloop);
+}
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *context;
+	GtkTreeStore *store;
+	GError *error = NULL;
+
+	context = g_option_context_new("TRACEFILE");
+	g_option_context_add_main_entries(context, options, NULL);
+
+	if (g_option_context_parse(context, &argc, &argv, &error) == FALSE) {
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return 1;
+	}
+
+	g_option_context_free(context);
+
+	if (argc < 2) {
+		g_printerr("Usage: %s [--realtime] TRACEFILE\n", argv[0]);
+		return 1;
+	}
+
+	g_type_init();
+	dbus_g_type_specialized_init();
+
+	mainloop = g_main_loop_new(NULL, FALSE);
+
+	store = connman_dbus_store_new();
+	connman_dbus_create_manager(NULL, store, NULL, NULL);
+
+	timer = g_timer_new();
+
+	if (connman_trace_replay(argv[1], option_realtime, replay_message,
+					replay_done, store) == TRUE &&
+							finished == FALSE)
+		g_main_loop_run(mainloop);
+
+	g_timer_destroy(timer);
+
+	connman_dbus_destroy_manager(NULL, store);
+	g_object_unref(store);
+
+	g_main_loop_unref(mainloop);
+
+	return 0;
+}
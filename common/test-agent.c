@@ -0,0 +1,265 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+
+#include "connman-agent.h"
+#include "connman-dbus.h"
+
+/*
+ * Soak test for the agent's life cycle.
+ *
+ * A private dbus-daemon stands in for the system bus and a mock
+ * connmand, a connection of its own that owns net.connman and answers
+ * RegisterAgent, is started and stopped over and over. The one agent
+ * has to register again after every restart, and the resident size of
+ * the process must stay flat once the first WARMUP cycles have filled
+ * the caches.
+ */
+
+#define CYCLES		2000
+#define WARMUP		200
+#define TIMEOUT		5		/* seconds per registration */
+#define GROWTH_LIMIT	(256 * 1024)	/* bytes */
+
+#define AGENT_PATH	"/org/gnome/connman/test"
+
+static guint registrations;
+static gboolean timed_out;
+
+static DBusHandlerResult mock_filter(DBusConnection *conn,
+				DBusMessage *message, void *user_data)
+{
+	DBusMessage *reply;
+
+	if (dbus_message_is_method_call(message, CONNMAN_MANAGER_INTERFACE,
+						"RegisterAgent") == FALSE &&
+			dbus_message_is_method_call(message,
+					CONNMAN_MANAGER_INTERFACE,
+					"UnregisterAgent") == FALSE)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (dbus_message_has_member(message, "RegisterAgent") == TRUE)
+		registrations++;
+
+	reply = dbus_message_new_method_return(message);
+	if (reply != NULL) {
+		dbus_connection_send(conn, reply, NULL);
+		dbus_message_unref(reply);
+	}
+
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static DBusConnection *mock_start(const char *address)
+{
+	DBusConnection *conn;
+	DBusError error;
+	int result;
+
+	dbus_error_init(&error);
+
+	conn = dbus_connection_open_private(address, &error);
+	if (conn == NULL)
+		goto failed;
+
+	if (dbus_bus_register(conn, &error) == FALSE)
+		goto close;
+
+	dbus_connection_add_filter(conn, mock_filter, NULL, NULL);
+	dbus_connection_setup_with_g_main(conn, NULL);
+
+	result = dbus_bus_request_name(conn, CONNMAN_SERVICE,
+					DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+	if (result == DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER)
+		return conn;
+
+close:
+	dbus_connection_close(conn);
+	dbus_connection_unref(conn);
+
+failed:
+	g_printerr("Can't start mock daemon: %s\n",
+			dbus_error_is_set(&error) ? error.message : "name taken");
+	dbus_error_free(&error);
+
+	return NULL;
+}
+
+static void mock_stop(DBusConnection *conn)
+{
+	/* Let the last reply out before the name goes away */
+	dbus_connection_flush(conn);
+	dbus_connection_close(conn);
+	dbus_connection_unref(conn);
+}
+
+static gboolean wait_timeout(gpointer user_data)
+{
+	timed_out = TRUE;
+
+	return FALSE;
+}
+
+static gboolean wait_registered(guint count)
+{
+	guint id;
+
+	timed_out = FALSE;
+	id = g_timeout_add_seconds(TIMEOUT, wait_timeout, NULL);
+
+	while (registrations < count && timed_out == FALSE)
+		g_main_context_iteration(NULL, TRUE);
+
+	if (timed_out == FALSE)
+		g_source_remove(id);
+
+	return registrations >= count;
+}
+
+static gsize resident_size(void)
+{
+	gchar *contents;
+	gulong size, resident;
+
+	if (g_file_get_contents("/proc/self/statm", &contents,
+						NULL, NULL) == FALSE)
+		return 0;
+
+	if (sscanf(contents, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+
+	g_free(contents);
+
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+/* Starts a bus of our own and returns its address */
+static gchar *bus_start(GPid *pid)
+{
+	gchar *argv[] = { "dbus-daemon", "--session", "--nofork",
+						"--print-address=1", NULL };
+	GIOChannel *channel;
+	GError *error = NULL;
+	gchar *address = NULL;
+	gint out;
+
+	if (g_spawn_async_with_pipes(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+				NULL, NULL, pid, NULL, &out, NULL,
+						&error) == FALSE) {
+		g_test_message("no dbus-daemon: %s", error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	channel = g_io_channel_unix_new(out);
+	g_io_channel_set_close_on_unref(channel, TRUE);
+
+	if (g_io_channel_read_line(channel, &address, NULL, NULL,
+						NULL) != G_IO_STATUS_NORMAL) {
+		g_free(address);
+		address = NULL;
+	} else
+		g_strstrip(address);
+
+	g_io_channel_unref(channel);
+
+	if (address == NULL) {
+		kill(*pid, SIGTERM);
+		g_spawn_close_pid(*pid);
+	}
+
+	return address;
+}
+
+static void test_restart(void)
+{
+	ConnmanAgent *agent;
+	DBusConnection *mock;
+	gsize before = 0, after;
+	gchar *address;
+	GPid pid;
+	guint i;
+
+	address = bus_start(&pid);
+	if (address == NULL) {
+		g_test_message("restart: skipped, no bus to test against");
+		return;
+	}
+
+	/* The agent always talks to the system bus */
+	g_setenv("DBUS_SYSTEM_BUS_ADDRESS", address, TRUE);
+
+	agent = connman_agent_new();
+	g_assert(connman_agent_setup(agent, AGENT_PATH) == TRUE);
+	g_assert(connman_agent_register(agent) == TRUE);
+
+	for (i = 0; i < CYCLES; i++) {
+		if (i == WARMUP)
+			before = resident_size();
+
+		mock = mock_start(address);
+		g_assert(mock != NULL);
+
+		if (wait_registered(i + 1) == FALSE)
+			g_error("agent didn't register after restart %u", i);
+
+		mock_stop(mock);
+	}
+
+	after = resident_size();
+
+	g_test_message("restart: %u cycles, resident size %lu -> %lu bytes",
+				CYCLES, (gulong) before, (gulong) after);
+
+	if (before > 0)
+		g_assert_cmpuint(after, <=, before + GROWTH_LIMIT);
+
+	connman_agent_unregister(agent);
+	g_object_unref(agent);
+
+	kill(pid, SIGTERM);
+	g_spawn_close_pid(pid);
+
+	g_free(address);
+}
+
+int main(int argc, char *argv[])
+{
+	g_type_init();
+
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/agent/restart", test_restart);
+
+	return g_test_run();
+}
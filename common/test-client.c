@@ -217,18 +217,38 @@ static void method_call(DBusGProxy *proxy, const char *method, const char *path)
 	}
 }
 
+static DBusGProxy *create_proxy(const gchar *path)
+{
+	DBusGConnection *connection;
+	DBusGProxy *proxy;
+
+	if (path == NULL)
+		return NULL;
+
+	connection = dbus_g_bus_get(DBUS_BUS_SYSTEM, NULL);
+	if (connection == NULL)
+		return NULL;
+
+	proxy = dbus_g_proxy_new_for_name(connection, "net.connman",
+						path, "net.connman.Service");
+
+	dbus_g_connection_unref(connection);
+
+	return proxy;
+}
+
 static DBusGProxy *get_proxy(GtkTreeSelection *selection)
 {
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	DBusGProxy *proxy = NULL;
+	const gchar *path;
 
 	if (gtk_tree_selection_get_selected(selection, &model, &iter) == FALSE)
 		return NULL;
 
-	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PROXY, &proxy, -1);
+	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &path, -1);
 
-	return proxy;
+	return create_proxy(path);
 }
 
 static void drag_data_get(GtkWidget *widget, GdkDragContext *context,
@@ -260,7 +280,7 @@ static void drag_data_received(GtkWidget *widget, GdkDragContext *context,
 	GtkTreeModel *model = user_data;
 	GtkTreePath *path;
 	GtkTreeIter iter;
-	DBusGProxy *source, *proxy = NULL;
+	const gchar *source, *target = NULL;
 	gboolean success = FALSE;
 
 	if (gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(widget),
@@ -270,7 +290,7 @@ static void drag_data_received(GtkWidget *widget, GdkDragContext *context,
 	if (gtk_tree_model_get_iter(model, &iter, path) == FALSE)
 		goto done;
 
-	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PROXY, &proxy, -1);
+	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &target, -1);
 
 	if (data == NULL || data->length == 0)
 		goto done;
@@ -284,11 +304,9 @@ static void drag_data_received(GtkWidget *widget, GdkDragContext *context,
 
 	g_print("%s -> %s\n", (gchar *) data->data, gtk_tree_path_to_string(path));
 
-	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PROXY, &source, -1);
-
-	method_call(source, "MoveBefore", dbus_g_proxy_get_path(proxy));
+	gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &source, -1);
 
-	g_object_unref(proxy);
+	method_call(create_proxy(source), "MoveBefore", target);
 
 	success = TRUE;
 
@@ -0,0 +1,759 @@
+/*
+ *
+ *  Connection Manager
+ *
+ *  Copyright (C) 2008  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dbus/dbus-glib.h>
+#include <gtk/gtk.h>
+
+#include "connman-client.h"
+#include "connman-dbus.h"
+
+/*
+ * Scaling tests for the store handlers in connman-dbus.c.
+ *
+ * The handlers are driven in-process through connman_dbus_replay()
+ * with synthetic replies and signals, so they see the same hash tables
+ * as they would from connmand. The manager has no bus behind it and
+ * the queued service updates are written with connman_dbus_flush(),
+ * except where the budget of a main loop iteration is tested.
+ *
+ * Every operation is timed at each store size and the cost per
+ * operation must not grow faster than its budget allows between the
+ * two largest sizes. The best of RUNS runs counts, so a single run
+ * that got preempted doesn't fail the suite.
+ */
+
+#define OPERATIONS	32
+#define RUNS		3
+
+/* Allowed cost growth per decade on top of the expected order */
+#define SLACK		4.0
+
+static const guint sizes[] = { 10, 100, 1000, 10000 };
+
+struct fixture {
+	GtkTreeStore *store;
+	DBusGProxy *manager;
+	guint added;
+	guint removed;
+	guint changed;
+};
+
+static void notify_callback(guint event, const char *path,
+					guint changed, gpointer user_data)
+{
+	struct fixture *fixture = user_data;
+
+	switch (event) {
+	case CONNMAN_DBUS_SERVICE_ADDED:
+		fixture->added++;
+		break;
+	case CONNMAN_DBUS_SERVICE_REMOVED:
+		fixture->removed++;
+		break;
+	case CONNMAN_DBUS_SERVICE_CHANGED:
+		fixture->changed++;
+		break;
+	}
+}
+
+static void append_variant(DBusMessageIter *iter, int type, void *value)
+{
+	DBusMessageIter variant;
+	char signature[2] = { type, '\0' };
+
+	dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT,
+							signature, &variant);
+	dbus_message_iter_append_basic(&variant, type, value);
+	dbus_message_iter_close_container(iter, &variant);
+}
+
+static void append_entry(DBusMessageIter *dict, const char *key,
+						int type, void *value)
+{
+	DBusMessageIter entry;
+
+	dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY,
+								NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	append_variant(&entry, type, value);
+	dbus_message_iter_close_container(dict, &entry);
+}
+
+static void open_dict(DBusMessageIter *iter, DBusMessageIter *dict)
+{
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_DICT_ENTRY_END_CHAR_AS_STRING, dict);
+}
+
+static void open_object_array(DBusMessageIter *iter, DBusMessageIter *array)
+{
+	dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY,
+			DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_OBJECT_PATH_AS_STRING
+			DBUS_TYPE_ARRAY_AS_STRING
+			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+			DBUS_STRUCT_END_CHAR_AS_STRING, array);
+}
+
+static char *service_path(guint index)
+{
+	return g_strdup_printf("/net/connman/service/wifi_%u", index);
+}
+
+static void append_service(DBusMessageIter *array, guint index)
+{
+	DBusMessageIter item, dict, entry, variant, list, ipv4;
+	const char *key, *type = "wifi", *state = "idle", *method = "dhcp";
+	const char *security = "psk";
+	char *path, *name;
+	dbus_bool_t favorite = FALSE;
+	unsigned char strength = 0;
+
+	path = service_path(index);
+	name = g_strdup_printf("network %u", index);
+
+	dbus_message_iter_open_container(array, DBUS_TYPE_STRUCT,
+								NULL, &item);
+	dbus_message_iter_append_basic(&item, DBUS_TYPE_OBJECT_PATH, &path);
+
+	open_dict(&item, &dict);
+
+	append_entry(&dict, "Name", DBUS_TYPE_STRING, &name);
+	append_entry(&dict, "Type", DBUS_TYPE_STRING, &type);
+	append_entry(&dict, "State", DBUS_TYPE_STRING, &state);
+	append_entry(&dict, "Favorite", DBUS_TYPE_BOOLEAN, &favorite);
+	append_entry(&dict, "Strength", DBUS_TYPE_BYTE, &strength);
+
+	key = "Security";
+	dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY,
+								NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT,
+			DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_STRING_AS_STRING,
+								&variant);
+	dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY,
+					DBUS_TYPE_STRING_AS_STRING, &list);
+	dbus_message_iter_append_basic(&list, DBUS_TYPE_STRING, &security);
+	dbus_message_iter_close_container(&variant, &list);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(&dict, &entry);
+
+	key = "IPv4.Configuration";
+	dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY,
+								NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT,
+			DBUS_TYPE_ARRAY_AS_STRING
+			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_DICT_ENTRY_END_CHAR_AS_STRING, &variant);
+	open_dict(&variant, &ipv4);
+	append_entry(&ipv4, "Method", DBUS_TYPE_STRING, &method);
+	dbus_message_iter_close_container(&variant, &ipv4);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(&dict, &entry);
+
+	dbus_message_iter_close_container(&item, &dict);
+	dbus_message_iter_close_container(array, &item);
+
+	g_free(name);
+	g_free(path);
+}
+
+static DBusMessage *properties_reply(void)
+{
+	DBusMessage *message;
+	DBusMessageIter iter, dict;
+	dbus_bool_t offline = FALSE;
+
+	message = dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+
+	dbus_message_iter_init_append(message, &iter);
+	open_dict(&iter, &dict);
+	append_entry(&dict, "OfflineMode", DBUS_TYPE_BOOLEAN, &offline);
+	dbus_message_iter_close_container(&iter, &dict);
+
+	return message;
+}
+
+static DBusMessage *technologies_reply(void)
+{
+	DBusMessage *message;
+	DBusMessageIter iter, array, item, dict;
+	const char *path = "/net/connman/technology/wifi", *type = "wifi";
+	dbus_bool_t powered = TRUE;
+
+	message = dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+
+	dbus_message_iter_init_append(message, &iter);
+	open_object_array(&iter, &array);
+
+	dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT,
+								NULL, &item);
+	dbus_message_iter_append_basic(&item, DBUS_TYPE_OBJECT_PATH, &path);
+	open_dict(&item, &dict);
+	append_entry(&dict, "Type", DBUS_TYPE_STRING, &type);
+	append_entry(&dict, "Powered", DBUS_TYPE_BOOLEAN, &powered);
+	dbus_message_iter_close_container(&item, &dict);
+	dbus_message_iter_close_container(&array, &item);
+
+	dbus_message_iter_close_container(&iter, &array);
+
+	return message;
+}
+
+static DBusMessage *services_reply(guint size, gboolean reverse)
+{
+	DBusMessage *message;
+	DBusMessageIter iter, array;
+	guint i;
+
+	message = dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+
+	dbus_message_iter_init_append(message, &iter);
+	open_object_array(&iter, &array);
+
+	for (i = 0; i < size; i++)
+		append_service(&array, reverse == TRUE ? size - i - 1 : i);
+
+	dbus_message_iter_close_container(&iter, &array);
+
+	return message;
+}
+
+static DBusMessage *services_changed(gint added, gint removed)
+{
+	DBusMessage *message;
+	DBusMessageIter iter, array;
+	char *path;
+
+	message = dbus_message_new_signal(CONNMAN_MANAGER_PATH,
+				CONNMAN_MANAGER_INTERFACE, "ServicesChanged");
+
+	dbus_message_iter_init_append(message, &iter);
+
+	open_object_array(&iter, &array);
+	if (added >= 0)
+		append_service(&array, added);
+	dbus_message_iter_close_container(&iter, &array);
+
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+				DBUS_TYPE_OBJECT_PATH_AS_STRING, &array);
+	if (removed >= 0) {
+		path = service_path(removed);
+		dbus_message_iter_append_basic(&array,
+					DBUS_TYPE_OBJECT_PATH, &path);
+		g_free(path);
+	}
+	dbus_message_iter_close_container(&iter, &array);
+
+	return message;
+}
+
+static DBusMessage *strength_changed(guint index, unsigned char strength)
+{
+	DBusMessage *message;
+	DBusMessageIter iter;
+	const char *property = "Strength";
+	char *path;
+
+	path = service_path(index);
+	message = dbus_message_new_signal(path, CONNMAN_SERVICE_INTERFACE,
+							"PropertyChanged");
+	g_free(path);
+
+	dbus_message_iter_init_append(message, &iter);
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &property);
+	append_variant(&iter, DBUS_TYPE_BYTE, &strength);
+
+	return message;
+}
+
+static void replay(struct fixture *fixture, DBusMessage *message)
+{
+	connman_dbus_replay(fixture->manager, fixture->store, message);
+	dbus_message_unref(message);
+}
+
+/* Replays the messages and returns the seconds they took */
+static gdouble replay_timed(struct fixture *fixture, GPtrArray *messages)
+{
+	gdouble elapsed;
+	guint i;
+
+	g_test_timer_start();
+
+	for (i = 0; i < messages->len; i++)
+		connman_dbus_replay(fixture->manager, fixture->store,
+					g_ptr_array_index(messages, i));
+
+	connman_dbus_flush(fixture->store);
+
+	elapsed = g_test_timer_elapsed();
+
+	for (i = 0; i < messages->len; i++)
+		dbus_message_unref(g_ptr_array_index(messages, i));
+
+	g_ptr_array_free(messages, TRUE);
+
+	return elapsed;
+}
+
+static gboolean count_service(GtkTreeModel *model, GtkTreePath *path,
+					GtkTreeIter *iter, gpointer user_data)
+{
+	guint *count = user_data;
+	guint type;
+
+	gtk_tree_model_get(model, iter, CONNMAN_COLUMN_TYPE, &type, -1);
+
+	if (type == CONNMAN_TYPE_WIFI)
+		(*count)++;
+
+	return FALSE;
+}
+
+static guint count_services(struct fixture *fixture)
+{
+	guint count = 0;
+
+	gtk_tree_model_foreach(GTK_TREE_MODEL(fixture->store),
+						count_service, &count);
+
+	return count;
+}
+
+/* The services have to be in the order of the last services_reply() */
+static void assert_order(struct fixture *fixture, guint size,
+							gboolean reverse)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(fixture->store);
+	GtkTreeIter iter;
+	gboolean cont;
+	const char *path;
+	char *expected;
+	guint type, i = 0;
+
+	cont = gtk_tree_model_get_iter_first(model, &iter);
+	while (cont == TRUE) {
+		gtk_tree_model_get(model, &iter, CONNMAN_COLUMN_PATH, &path,
+					CONNMAN_COLUMN_TYPE, &type, -1);
+
+		if (type == CONNMAN_TYPE_WIFI) {
+			expected = service_path(reverse == TRUE ?
+							size - i - 1 : i);
+			g_assert_cmpstr(path, ==, expected);
+			g_free(expected);
+			i++;
+		}
+
+		cont = gtk_tree_model_iter_next(model, &iter);
+	}
+
+	g_assert_cmpuint(i, ==, size);
+}
+
+static void fixture_setup(struct fixture *fixture, guint size)
+{
+	memset(fixture, 0, sizeof(*fixture));
+
+	fixture->store = connman_dbus_store_new();
+
+	fixture->manager = connman_dbus_create_manager(NULL,
+				fixture->store, notify_callback, fixture);
+
+	replay(fixture, properties_reply());
+	replay(fixture, technologies_reply());
+	replay(fixture, services_reply(size, FALSE));
+
+	g_assert(connman_dbus_is_populated(fixture->store) == TRUE);
+	g_assert_cmpuint(fixture->added, ==, size);
+	assert_order(fixture, size, FALSE);
+
+	fixture->added = 0;
+}
+
+static void fixture_teardown(struct fixture *fixture)
+{
+	connman_dbus_destroy_manager(fixture->manager, fixture->store);
+	g_object_unref(fixture->store);
+}
+
+static gdouble run_insert(struct fixture *fixture, guint size)
+{
+	GPtrArray *messages = g_ptr_array_new();
+	gdouble elapsed;
+	guint i;
+
+	for (i = 0; i < OPERATIONS; i++)
+		g_ptr_array_add(messages, services_changed(size + i, -1));
+
+	elapsed = replay_timed(fixture, messages);
+
+	g_assert_cmpuint(fixture->added, ==, OPERATIONS);
+	g_assert_cmpuint(count_services(fixture), ==, size + OPERATIONS);
+
+	return elapsed / OPERATIONS;
+}
+
+static gdouble run_update(struct fixture *fixture, guint size)
+{
+	GPtrArray *messages = g_ptr_array_new();
+	gdouble elapsed;
+	guint i;
+
+	for (i = 0; i < OPERATIONS; i++)
+		g_ptr_array_add(messages, strength_changed(i * size / OPERATIONS,
+									i + 1));
+
+	elapsed = replay_timed(fixture, messages);
+
+	g_assert_cmpuint(fixture->changed, ==, OPERATIONS);
+
+	return elapsed / OPERATIONS;
+}
+
+static gdouble run_remove(struct fixture *fixture, guint size)
+{
+	GPtrArray *messages = g_ptr_array_new();
+	gdouble elapsed;
+	guint i, count = MIN(size, OPERATIONS);
+
+	for (i = 0; i < count; i++)
+		g_ptr_array_add(messages, services_changed(-1,
+							i * size / count));
+
+	elapsed = replay_timed(fixture, messages);
+
+	g_assert_cmpuint(fixture->removed, ==, count);
+	g_assert_cmpuint(count_services(fixture), ==, size - count);
+
+	return elapsed / count;
+}
+
+static gdouble run_reorder(struct fixture *fixture, guint size)
+{
+	GPtrArray *messages = g_ptr_array_new();
+	gdouble elapsed;
+
+	/* connmand sorts its list again after every scan */
+	connman_dbus_resync(fixture->manager, fixture->store);
+
+	g_ptr_array_add(messages, properties_reply());
+	g_ptr_array_add(messages, technologies_reply());
+	g_ptr_array_add(messages, services_reply(size, TRUE));
+
+	elapsed = replay_timed(fixture, messages);
+
+	g_assert_cmpuint(fixture->added, ==, 0);
+	g_assert_cmpuint(fixture->removed, ==, 0);
+	g_assert_cmpuint(fixture->changed, ==, 0);
+	assert_order(fixture, size, TRUE);
+
+	return elapsed / size;
+}
+
+struct operation {
+	const char *name;
+	gdouble (*run) (struct fixture *fixture, guint size);
+	guint order;
+};
+
+/*
+ * Lookups by object path walk the whole store, so adding, updating and
+ * removing a single service is linear for now. A resync looks the rows
+ * up in a hash table and must stay constant per service, apart from
+ * sorting them into the new order once.
+ */
+static const struct operation operations[] = {
+	{ "insert",	run_insert,	1 },
+	{ "update",	run_update,	1 },
+	{ "remove",	run_remove,	1 },
+	{ "reorder",	run_reorder,	0 },
+};
+
+static void test_operation(gconstpointer data)
+{
+	const struct operation *operation = data;
+	gdouble cost[G_N_ELEMENTS(sizes)], growth, budget, run;
+	struct fixture fixture;
+	guint i, j, last;
+
+	for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+		for (j = 0; j < RUNS; j++) {
+			fixture_setup(&fixture, sizes[i]);
+			run = operation->run(&fixture, sizes[i]);
+			fixture_teardown(&fixture);
+
+			if (j == 0 || run < cost[i])
+				cost[i] = run;
+		}
+
+		g_test_message("%s: %u services, %.2f us per operation",
+				operation->name, sizes[i], cost[i] * 1e6);
+	}
+
+	last = G_N_ELEMENTS(sizes) - 1;
+
+	growth = cost[last] / MAX(cost[last - 1], 1e-9);
+	budget = pow((gdouble) sizes[last] / sizes[last - 1],
+						operation->order) * SLACK;
+
+	g_test_message("%s: cost grew %.1fx from %u to %u services, "
+			"budget %.1fx", operation->name, growth,
+			sizes[last - 1], sizes[last], budget);
+
+	g_assert_cmpfloat(growth, <=, budget);
+}
+
+static guint get_strength(struct fixture *fixture, guint index)
+{
+	GtkTreeIter iter;
+	guint strength = 0;
+	char *path;
+
+	path = service_path(index);
+
+	if (connman_dbus_get_iter(fixture->store, path, &iter) == TRUE)
+		gtk_tree_model_get(GTK_TREE_MODEL(fixture->store), &iter,
+				CONNMAN_COLUMN_STRENGTH, &strength, -1);
+
+	g_free(path);
+
+	return strength;
+}
+
+/* A burst of updates for one service is written once, with the last value */
+static void test_queue_merge(void)
+{
+	struct fixture fixture;
+	guint i;
+
+	fixture_setup(&fixture, 10);
+
+	for (i = 1; i <= 5; i++)
+		replay(&fixture, strength_changed(3, i * 10));
+
+	g_assert_cmpuint(fixture.changed, ==, 0);
+
+	connman_dbus_flush(fixture.store);
+
+	g_assert_cmpuint(fixture.changed, ==, 1);
+	g_assert_cmpuint(get_strength(&fixture, 3), ==, 50);
+
+	fixture_teardown(&fixture);
+}
+
+/* A removal drops whatever was queued for the service before it */
+static void test_queue_drop(void)
+{
+	struct fixture fixture;
+
+	fixture_setup(&fixture, 10);
+
+	replay(&fixture, strength_changed(3, 40));
+	replay(&fixture, services_changed(-1, 3));
+
+	connman_dbus_flush(fixture.store);
+
+	g_assert_cmpuint(fixture.changed, ==, 0);
+	g_assert_cmpuint(fixture.removed, ==, 1);
+	g_assert_cmpuint(count_services(&fixture), ==, 9);
+
+	/* Added back in the same burst, with what came after it */
+	replay(&fixture, services_changed(-1, 4));
+	replay(&fixture, services_changed(4, -1));
+	replay(&fixture, strength_changed(4, 70));
+
+	connman_dbus_flush(fixture.store);
+
+	g_assert_cmpuint(fixture.removed, ==, 2);
+	g_assert_cmpuint(fixture.added, ==, 1);
+	g_assert_cmpuint(fixture.changed, ==, 1);
+	g_assert_cmpuint(count_services(&fixture), ==, 9);
+	g_assert_cmpuint(get_strength(&fixture, 4), ==, 70);
+
+	fixture_teardown(&fixture);
+}
+
+/* Strength of a hidden row waits for the store, but not for anyone else */
+static void test_queue_shadow(void)
+{
+	struct fixture fixture;
+	GHashTable *visible;
+	guint strength = 0;
+	char *path;
+
+	fixture_setup(&fixture, 10);
+
+	visible = g_hash_table_new_full(g_str_hash, g_str_equal,
+								g_free, NULL);
+	g_hash_table_insert(visible, service_path(0), NULL);
+	connman_dbus_set_visible(fixture.store, visible);
+
+	replay(&fixture, strength_changed(3, 60));
+
+	connman_dbus_flush(fixture.store);
+
+	path = service_path(3);
+
+	g_assert_cmpuint(fixture.changed, ==, 1);
+	g_assert_cmpuint(get_strength(&fixture, 3), ==, 0);
+	g_assert(connman_dbus_get_strength(fixture.store, path,
+							&strength) == TRUE);
+	g_assert_cmpuint(strength, ==, 60);
+
+	connman_dbus_set_visible(fixture.store, NULL);
+
+	g_assert_cmpuint(get_strength(&fixture, 3), ==, 60);
+
+	g_free(path);
+
+	fixture_teardown(&fixture);
+}
+
+/* One main loop iteration writes no more than its budget allows */
+static void test_queue_budget(void)
+{
+	struct fixture fixture;
+	guint i, size = sizes[G_N_ELEMENTS(sizes) - 1], count = size / 10;
+
+	fixture_setup(&fixture, size);
+
+	for (i = 0; i < count; i++)
+		replay(&fixture, strength_changed(i * 10, 1 + i % 100));
+
+	g_main_context_iteration(NULL, FALSE);
+
+	g_test_message("budget: %u of %u updates written in one iteration",
+						fixture.changed, count);
+
+	g_assert_cmpuint(fixture.changed, >, 0);
+	g_assert_cmpuint(fixture.changed, <, count);
+
+	connman_dbus_flush(fixture.store);
+
+	g_assert_cmpuint(fixture.changed, ==, count);
+
+	fixture_teardown(&fixture);
+}
+
+static gsize resident_size(void)
+{
+	gchar *contents;
+	gulong size, resident;
+
+	if (g_file_get_contents("/proc/self/statm", &contents,
+						NULL, NULL) == FALSE)
+		return 0;
+
+	if (sscanf(contents, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+
+	g_free(contents);
+
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+/*
+ * Reports what a service costs, rows, hash tables and interned strings
+ * included, from the growth of the resident set while the largest store
+ * is published. The replies are built beforehand, but what they allocate
+ * while being decoded stays resident, so this is an upper bound. Nothing
+ * is asserted since the figure depends on the allocator.
+ */
+static void test_memory(void)
+{
+	DBusMessage *messages[3];
+	struct fixture fixture;
+	guint i, size = sizes[G_N_ELEMENTS(sizes) - 1];
+	gsize before, after;
+
+	messages[0] = properties_reply();
+	messages[1] = technologies_reply();
+	messages[2] = services_reply(size, FALSE);
+
+	memset(&fixture, 0, sizeof(fixture));
+
+	before = resident_size();
+
+	fixture.store = connman_dbus_store_new();
+	fixture.manager = connman_dbus_create_manager(NULL, fixture.store,
+						notify_callback, &fixture);
+
+	for (i = 0; i < G_N_ELEMENTS(messages); i++)
+		connman_dbus_replay(fixture.manager, fixture.store,
+								messages[i]);
+
+	after = resident_size();
+
+	g_assert_cmpuint(fixture.added, ==, size);
+
+	if (before == 0)
+		g_test_message("memory: resident size not available");
+	else
+		g_test_message("memory: %u services, %lu bytes per service",
+				size, (gulong) (after - MIN(before, after)) / size);
+
+	for (i = 0; i < G_N_ELEMENTS(messages); i++)
+		dbus_message_unref(messages[i]);
+
+	fixture_teardown(&fixture);
+}
+
+int main(int argc, char *argv[])
+{
+	char *name;
+	guint i;
+
+	g_type_init();
+
+	dbus_g_type_specialized_init();
+
+	g_test_init(&argc, &argv, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(operations); i++) {
+		name = g_strdup_printf("/store/%s", operations[i].name);
+		g_test_add_data_func(name, &operations[i], test_operation);
+		g_free(name);
+	}
+
+	g_test_add_func("/store/queue/merge", test_queue_merge);
+	g_test_add_func("/store/queue/drop", test_queue_drop);
+	g_test_add_func("/store/queue/shadow", test_queue_shadow);
+	g_test_add_func("/store/queue/budget", test_queue_budget);
+	g_test_add_func("/store/memory", test_memory);
+
+	return g_test_run();
+}
@@ -53,6 +53,7 @@ struct config_data {
 		GtkWidget *name;
 		GtkWidget *security;
 		GtkWidget *strength;
+		GtkWidget *timing;
 		GtkWidget *connect_info;
 		GtkWidget *connect;
 		GtkWidget *disconnect;
@@ -61,6 +62,7 @@ struct config_data {
 	struct {
 		GtkWidget *name;
 		GtkWidget *strength;
+		GtkWidget *timing;
 		GtkWidget *connect_info;
 		GtkWidget *connect;
 		GtkWidget *disconnect;
@@ -89,6 +91,8 @@ static inline gboolean separator_function(GtkTreeModel *model,
 	return result;
 }
 
+void update_connect_timing(struct config_data *data, GtkWidget *label);
+
 void add_ethernet_service(GtkWidget *mainbox, GtkTreeIter *iter, struct config_data *data);
 void update_ethernet_ipv4(struct config_data *data, guint policy);
 
@@ -144,6 +144,15 @@ void add_cellular_service(GtkWidget *mainbox, GtkTreeIter *iter, struct config_d
 	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
 	data->cellular.name = label;
 
+	label = gtk_label_new(_("Last connect:"));
+	gtk_table_attach_defaults(GTK_TABLE(table), label, 3, 4, 1, 2);
+
+	label = gtk_label_new(NULL);
+	gtk_table_attach_defaults(GTK_TABLE(table), label, 4, 5, 1, 2);
+	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
+	data->cellular.timing = label;
+	update_connect_timing(data, label);
+
 	label = gtk_label_new(_(""));
 	gtk_table_attach_defaults(GTK_TABLE(table), label, 3, 5, 2, 3);
 	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.0);
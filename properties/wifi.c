@@ -160,12 +160,69 @@ void add_wifi_switch_button(GtkWidget *mainbox, GtkTreeIter *iter,
 			G_CALLBACK(scan_callback), data);
 }
 
+/*
+ * Samples are only taken when strength or state moved, so each one
+ * holds until the next and the line is drawn in steps over the time
+ * from the first sample to now.
+ */
+static gboolean history_expose(GtkWidget *widget, GdkEventExpose *event,
+							gpointer user_data)
+{
+	struct config_data *data = user_data;
+	struct connman_sample samples[CONNMAN_HISTORY_LENGTH];
+	cairo_t *cr;
+	GTimeVal now;
+	gint64 start, span;
+	gdouble x, y = 0, width, height;
+	guint i, count;
+
+	count = connman_client_get_history(data->client, data->device,
+					samples, G_N_ELEMENTS(samples));
+	if (count == 0)
+		return FALSE;
+
+	g_get_current_time(&now);
+
+	start = samples[0].time;
+	span = (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec - start;
+	if (span <= 0)
+		return FALSE;
+
+	width = widget->allocation.width - 2;
+	height = widget->allocation.height - 2;
+
+	cr = gdk_cairo_create(widget->window);
+	gdk_cairo_set_source_color(cr, &widget->style->fg[GTK_STATE_NORMAL]);
+	cairo_set_line_width(cr, 1.0);
+
+	for (i = 0; i < count; i++) {
+		x = 1 + width * (samples[i].time - start) / span;
+
+		/* The previous value holds up to here */
+		if (i > 0)
+			cairo_line_to(cr, x, y);
+
+		y = 1 + height - height * MIN(samples[i].strength, 100) / 100;
+
+		if (i == 0)
+			cairo_move_to(cr, x, y);
+		else
+			cairo_line_to(cr, x, y);
+	}
+
+	cairo_line_to(cr, 1 + width, y);
+
+	cairo_stroke(cr);
+	cairo_destroy(cr);
+
+	return TRUE;
+}
+
 static void wifi_ipconfig(GtkWidget *table, struct config_data *data, GtkTreeIter *iter)
 {
 	GtkWidget *entry;
 	GtkWidget *label;
 	GtkWidget *combo;
-	DBusGProxy *proxy;
 
 	struct ipv4_config ipv4_config = {
 		.method  = NULL,
@@ -175,7 +232,6 @@ static void wifi_ipconfig(GtkWidget *table, struct config_data *data, GtkTreeIte
 	};
 
 	gtk_tree_model_get(data->model, iter,
-			CONNMAN_COLUMN_PROXY, &proxy,
 			CONNMAN_COLUMN_METHOD, &ipv4_config.method,
 			CONNMAN_COLUMN_ADDRESS, &ipv4_config.address,
 			CONNMAN_COLUMN_NETMASK, &ipv4_config.netmask,
@@ -245,6 +301,7 @@ void add_wifi_service(GtkWidget *mainbox, GtkTreeIter *iter, struct config_data
 	GtkWidget *table;
 	GtkWidget *label;
 	GtkWidget *button;
+	GtkWidget *area;
 
 	const char *name, *security, *icon, *state;
 	guint strength;
@@ -286,6 +343,24 @@ void add_wifi_service(GtkWidget *mainbox, GtkTreeIter *iter, struct config_data
 	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
 	data->wifi.security = label;
 
+	label = gtk_label_new(_("Signal:"));
+	gtk_table_attach_defaults(GTK_TABLE(table), label, 1, 2, 2, 3);
+
+	area = gtk_drawing_area_new();
+	gtk_table_attach_defaults(GTK_TABLE(table), area, 2, 4, 2, 3);
+	g_signal_connect(G_OBJECT(area), "expose-event",
+			G_CALLBACK(history_expose), data);
+	data->wifi.strength = area;
+
+	label = gtk_label_new(_("Last connect:"));
+	gtk_table_attach_defaults(GTK_TABLE(table), label, 1, 2, 7, 8);
+
+	label = gtk_label_new(NULL);
+	gtk_table_attach_defaults(GTK_TABLE(table), label, 2, 4, 7, 8);
+	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
+	data->wifi.timing = label;
+	update_connect_timing(data, label);
+
 	label = gtk_label_new(_(""));
 	gtk_table_attach_defaults(GTK_TABLE(table), label, 2, 3, 8, 9);
 	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.0);